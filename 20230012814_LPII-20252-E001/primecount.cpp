@@ -12,9 +12,42 @@
 #include <cmath>        // Funções matemáticas (sqrt)
 #include <cstring>      // Manipulação de strings estilo C
 #include <chrono>       // Medição de tempo de alta precisão
+#include <cstdint>      // Inteiros de largura fixa (uint64_t, uint32_t)
+#include <climits>      // INT_MAX (limite de P na lista do bench)
+#include <algorithm>    // std::max, std::min
+#include <atomic>       // std::atomic (cursor compartilhado entre processos)
+#include <new>          // placement new sobre a região mmap
+#include <thread>       // std::thread (modo par-threads)
+#include <mutex>        // std::mutex das filas de tarefas
+#include <deque>        // std::deque (fila dupla de work-stealing)
+#include <functional>   // std::function (tarefas sobre intervalos)
+#include <fstream>      // Relatórios e baseline do benchmark
+#include <map>          // Índice da baseline do benchmark
+#include <sys/resource.h> // getrusage/wait4 (pico de memória e tempo de CPU)
+#include <ctime>        // clock_gettime (timestamps de --stats)
 #include <unistd.h>     // Chamadas POSIX: fork, pipe, write, read, close
 #include <sys/wait.h>   // Funções de espera por processos filhos (wait)
 #include <sys/mman.h>   // mmap/munmap para memória compartilhada (SHM)
+#include <sys/eventfd.h> // eventfd (IPC "eventfd")
+#include <sys/syscall.h> // syscall(SYS_futex / SYS_waitid)
+#include <linux/futex.h> // FUTEX_WAIT/FUTEX_WAKE (IPC "futex")
+#include <poll.h>       // poll sobre o eventfd com timeout
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // Intrínsecos AVX2/AVX-512 (--algo simd)
+#endif
+#include <sys/stat.h>   // fstat (tamanho do arquivo de cache)
+#include <sys/file.h>   // flock (escrita concorrente no arquivo de cache)
+#include <fcntl.h>      // open (arquivo de cache)
+#include <semaphore.h>  // sem_t compartilhado entre processos (anéis do serve)
+#include <sched.h>      // sched_yield
+#include <cerrno>       // errno (EINTR)
+#include <sys/socket.h> // Socket Unix do subcomando serve
+#include <sys/un.h>     // sockaddr_un
+#include <netdb.h>      // getaddrinfo (coordinator/worker via TCP)
+#include <netinet/in.h> // IPPROTO_TCP
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <csignal>      // sigaction (encerramento do serve)
+#include <sys/prctl.h>  // PR_SET_PDEATHSIG (workers do serve)
 
 // ==========================================
 // PARTE B: Lógica de Primalidade e Worker
@@ -28,7 +61,7 @@
  * divisores até a raiz quadrada de n.
  * Complexidade assintótica: O(sqrt(n)).
  */
-bool is_prime_basic(int n) {
+bool is_prime_basic(uint64_t n) {
     // Casos base: números menores que 2 não são primos
     if (n < 2) return false;
     // 2 é o único número par primo
@@ -38,22 +71,30 @@ bool is_prime_basic(int n) {
     
     // Otimização: Testa apenas divisores ímpares de 3 até a raiz quadrada de n.
     // Se n tiver um fator maior que sqrt(n), o outro fator necessariamente é menor que sqrt(n).
-    for (int i = 3; i * i <= n; i += 2) {
+    // Para n < 2^32 usa aritmética de 32 bits: a divisão de 64 bits é bem mais lenta.
+    if (n <= UINT32_MAX) {
+        uint32_t m = (uint32_t)n;
+        for (uint64_t i = 3; i * i <= m; i += 2) {
+            if (m % (uint32_t)i == 0) return false;
+        }
+        return true;
+    }
+    // Com n < MAX_N = 2^63, i * i nunca transborda antes de o laço terminar.
+    for (uint64_t i = 3; i * i <= n; i += 2) {
         if (n % i == 0) return false;
     }
     return true;
 }
 
 /**
- * Função: count_primes_interval
- * -----------------------------
- * Conta quantos números primos existem em um intervalo fechado [start, end].
- * Esta é a "tarefa de trabalho" que será executada tanto pelo modo
- * sequencial quanto pelos processos filhos (workers) no modo paralelo.
+ * Função: count_primes_basic
+ * --------------------------
+ * Conta os primos de [start, end] testando cada número com is_prime_basic.
+ * Complexidade: O((end - start) * sqrt(end)).
  */
-long long count_primes_interval(int start, int end) {
+long long count_primes_basic(uint64_t start, uint64_t end) {
     long long prime_count = 0;
-    for (int i = start; i <= end; i++) {
+    for (uint64_t i = start; i <= end; i++) {
         if (is_prime_basic(i)) {
             prime_count++;
         }
@@ -61,184 +102,4013 @@ long long count_primes_interval(int start, int end) {
     return prime_count;
 }
 
+// ==========================================
+// Memória: Huge Pages
+// ==========================================
+
+/**
+ * Política de huge pages do processo, definida uma única vez em main (antes
+ * de qualquer fork, para ser herdada pelos workers):
+ * - "off":      alocação comum (padrão);
+ * - "thp":      mmap + madvise(MADV_HUGEPAGE), pedindo Transparent Huge Pages;
+ * - "explicit": mmap com MAP_HUGETLB (páginas reservadas em
+ *               /proc/sys/vm/nr_hugepages); sem reserva, recai em "thp".
+ */
+std::string hugepage_policy = "off";
+
+constexpr std::size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+/**
+ * Função: map_pages
+ * -----------------
+ * Mapeia 'size' bytes anônimos (privados ou compartilhados) seguindo a
+ * política de huge pages. Com MAP_HUGETLB, 'size' é arredondado para
+ * múltiplo de 2 MiB e devolvido atualizado, pois munmap precisa do mesmo
+ * tamanho. Retorna MAP_FAILED em erro, como mmap.
+ */
+void* map_pages(size_t& size, bool shared) {
+    int flags = MAP_ANONYMOUS | (shared ? MAP_SHARED : MAP_PRIVATE);
+    if (hugepage_policy == "explicit") {
+        size_t huge_size = (size + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+        void* region = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (region != MAP_FAILED) {
+            size = huge_size;
+            return region;
+        }
+        static std::atomic<bool> warned(false); // Avisa uma vez, mesmo com várias threads
+        if (!warned.exchange(true)) {
+            perror("Aviso: MAP_HUGETLB indisponível, usando THP");
+        }
+    }
+
+    void* region = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (region != MAP_FAILED && hugepage_policy != "off") {
+        madvise(region, size, MADV_HUGEPAGE);
+    }
+    return region;
+}
+
+/**
+ * Estrutura: PageBuffer
+ * ---------------------
+ * Buffer de trabalho (tabela de primos-base, segmento do crivo) alocado
+ * conforme a política de huge pages. Com "off" é um new[] comum, como
+ * antes; nos demais casos vem de map_pages. É alocado pelo próprio worker
+ * depois do pinning (--pin), então a política padrão do Linux, em que a
+ * página fica no nó de quem a toca primeiro (first-touch), já o coloca
+ * na memória NUMA local do núcleo do worker.
+ */
+struct PageBuffer {
+    char* data = nullptr;
+    size_t size = 0;
+    size_t mapped_size = 0; // 0 quando alocado com new[]
+
+    explicit PageBuffer(size_t bytes) : size(bytes) {
+        if (hugepage_policy == "off") {
+            data = new char[bytes];
+            return;
+        }
+        mapped_size = bytes;
+        void* region = map_pages(mapped_size, false);
+        if (region == MAP_FAILED) {
+            perror("Erro no mmap");
+            exit(1);
+        }
+        data = (char*)region;
+    }
+
+    ~PageBuffer() {
+        if (mapped_size == 0) delete[] data;
+        else munmap(data, mapped_size);
+    }
+
+    PageBuffer(const PageBuffer&) = delete;
+    PageBuffer& operator=(const PageBuffer&) = delete;
+};
+
+// ==========================================
+// Crivo de Eratóstenes Segmentado
+// ==========================================
+
+/**
+ * Função: isqrt_u64
+ * -----------------
+ * Raiz quadrada inteira (piso) de n, exata para todo uint64_t.
+ * Parte da estimativa em ponto flutuante e corrige o arredondamento
+ * comparando com divisões, sem nunca calcular um quadrado que transborde.
+ */
+uint64_t isqrt_u64(uint64_t n) {
+    uint64_t root = (uint64_t)std::sqrt((double)n);
+    while (root > 0 && root > n / root) root--;
+    while (root + 1 <= n / (root + 1)) root++;
+    return root;
+}
+
+// Tamanho de cada segmento do crivo, em bytes. Cada byte representa um número
+// ímpar, então um segmento de 32 KiB cobre 64 Ki números e cabe na cache L1d,
+// mantendo a memória usada independente de N. Ajustável por --segment ou
+// pelo perfil do 'tune' (definido em main, antes de qualquer fork).
+std::size_t sieve_segment_bytes = 32 * 1024;
+
+/**
+ * Função: sieve_base_primes
+ * -------------------------
+ * Gera os primos ÍMPARES até 'limit' com um crivo simples (não segmentado).
+ * São os "primos-base" usados para riscar os múltiplos em cada segmento;
+ * como limit = sqrt(end), o vetor é pequeno mesmo para end = 1e10.
+ */
+std::vector<uint32_t> sieve_base_primes(uint32_t limit) {
+    std::vector<uint32_t> primes;
+    if (limit < 3) return primes;
+
+    PageBuffer table(limit + 1);
+    char* composite = table.data;
+    std::fill(composite, composite + limit + 1, 0);
+    for (uint64_t i = 3; i * i <= limit; i += 2) {
+        if (!composite[i]) {
+            for (uint64_t j = i * i; j <= limit; j += 2 * i) composite[j] = 1;
+        }
+    }
+    for (uint32_t i = 3; i <= limit; i += 2) {
+        if (!composite[i]) primes.push_back(i);
+    }
+    return primes;
+}
+
+/**
+ * Função: sieve_odd_segments
+ * --------------------------
+ * Núcleo do crivo de Eratóstenes segmentado, representando apenas ímpares.
+ * Passos:
+ * 1. Calcula uma única vez os primos-base ímpares até sqrt(end).
+ * 2. Percorre [start, end] (start ímpar >= 3) em segmentos de
+ *    sieve_segment_bytes ímpares, riscando os múltiplos de cada primo-base.
+ * 3. Entrega cada segmento crivado a 'on_segment(low, segment, size)', onde
+ *    segment[i] != 0 indica que low + 2*i é primo.
+ * Memória: O(sqrt(end) + segmento), independente do tamanho do intervalo.
+ */
+template <typename SegmentFn>
+void sieve_odd_segments(uint64_t start, uint64_t end, SegmentFn on_segment) {
+    uint64_t root = isqrt_u64(end);
+    std::vector<uint32_t> base_primes = sieve_base_primes((uint32_t)root);
+
+    // next_index[k]: índice (no segmento atual) do próximo múltiplo ímpar de
+    // base_primes[k] a riscar. Preservado entre segmentos para evitar divisões.
+    std::vector<uint64_t> next_index(base_primes.size());
+    for (std::size_t k = 0; k < base_primes.size(); k++) {
+        uint64_t p = base_primes[k];
+        uint64_t first = std::max(p * p, (start + p - 1) / p * p);
+        if (first % 2 == 0) first += p; // apenas múltiplos ímpares
+        next_index[k] = (first - start) / 2;
+    }
+
+    PageBuffer buffer(sieve_segment_bytes);
+    char* segment = buffer.data;
+    // Byte i do segmento representa o número low + 2*i
+    for (uint64_t low = start; low <= end; low += 2 * (uint64_t)sieve_segment_bytes) {
+        uint64_t size = std::min<uint64_t>(sieve_segment_bytes, (end - low) / 2 + 1);
+        std::fill(segment, segment + size, 1);
+
+        for (std::size_t k = 0; k < base_primes.size(); k++) {
+            uint64_t p = base_primes[k];
+            uint64_t j = next_index[k];
+            for (; j < size; j += p) segment[j] = 0;
+            // Rebase do índice para o início do próximo segmento
+            next_index[k] = j - size;
+        }
+
+        on_segment(low, segment, size);
+    }
+}
+
+/**
+ * Função: count_primes_sieve
+ * --------------------------
+ * Conta os primos de [start, end] com o crivo segmentado (sieve_odd_segments),
+ * somando os bytes não riscados de cada segmento.
+ * Complexidade: O((end - start) * log log end + sqrt(end)).
+ */
+long long count_primes_sieve(uint64_t start, uint64_t end) {
+    if (end < 2 || start > end) return 0;
+
+    long long prime_count = 0;
+    // O 2 é o único primo par e fica fora da representação só de ímpares
+    if (start <= 2) {
+        prime_count = 1;
+        start = 3;
+    }
+    if (start % 2 == 0) start++;
+    if (start > end) return prime_count;
+
+    sieve_odd_segments(start, end, [&prime_count](uint64_t, const char* segment, uint64_t size) {
+        long long segment_count = 0;
+        for (uint64_t i = 0; i < size; i++) segment_count += segment[i];
+        prime_count += segment_count;
+    });
+
+    return prime_count;
+}
+
+/**
+ * Função: for_each_prime_sieve
+ * ----------------------------
+ * Enumera em ordem crescente os primos de [start, end], chamando
+ * 'on_prime(p)' para cada um. Usa o mesmo crivo segmentado da contagem.
+ */
+template <typename PrimeFn>
+void for_each_prime_sieve(uint64_t start, uint64_t end, PrimeFn on_prime) {
+    if (end < 2 || start > end) return;
+    if (start <= 2) {
+        on_prime((uint64_t)2);
+        start = 3;
+    }
+    if (start % 2 == 0) start++;
+    if (start > end) return;
+
+    sieve_odd_segments(start, end, [&on_prime](uint64_t low, const char* segment, uint64_t size) {
+        for (uint64_t i = 0; i < size; i++) {
+            if (segment[i]) on_prime(low + 2 * i);
+        }
+    });
+}
+
+// ==========================================
+// Miller-Rabin Determinístico (64 bits)
+// ==========================================
+
+// Inteiro de 128 bits do GCC/Clang, usado nos produtos de 64x64 bits.
+// __extension__ evita o aviso de -pedantic sobre o tipo não padronizado.
+__extension__ typedef unsigned __int128 uint128_t;
+
+/**
+ * Estrutura: Montgomery64
+ * -----------------------
+ * Aritmética modular em forma de Montgomery para um módulo ímpar n < 2^64.
+ * Cada multiplicação modular vira dois produtos de 64x64 bits e uma
+ * subtração, sem a instrução de divisão de 128 bits (a parte cara de
+ * (a * b) % n). Os valores ficam representados como a * 2^64 mod n.
+ */
+struct Montgomery64 {
+    uint64_t n;     // Módulo (ímpar)
+    uint64_t inv;   // n^-1 mod 2^64
+    uint64_t r2;    // 2^128 mod n, para converter para a forma de Montgomery
+    uint64_t one;   // 1 na forma de Montgomery (2^64 mod n)
+
+    explicit Montgomery64(uint64_t modulus) : n(modulus) {
+        // Newton-Raphson: cada iteração dobra os bits corretos do inverso (3 -> 96)
+        inv = n;
+        for (int i = 0; i < 5; i++) inv *= 2 - n * inv;
+        one = (0 - n) % n;
+        r2 = (uint64_t)(((uint128_t)one * one) % n);
+    }
+
+    // REDC: devolve t * 2^-64 mod n, para t < n * 2^64
+    uint64_t reduce(uint128_t t) const {
+        uint64_t m = (uint64_t)t * inv;
+        uint64_t mn_high = (uint64_t)(((uint128_t)m * n) >> 64);
+        uint64_t t_high = (uint64_t)(t >> 64);
+        // As metades baixas de t e m*n são iguais por construção; basta subtrair as altas
+        return t_high >= mn_high ? t_high - mn_high : t_high - mn_high + n;
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce((uint128_t)a * b); }
+    uint64_t to_mont(uint64_t a) const { return mul(a % n, r2); }
+
+    uint64_t pow(uint64_t base, uint64_t exp) const {
+        uint64_t result = one;
+        while (exp > 0) {
+            if (exp & 1) result = mul(result, base);
+            base = mul(base, base);
+            exp >>= 1;
+        }
+        return result;
+    }
+};
+
+// Primos pequenos usados como filtro por divisão antes do Miller-Rabin.
+// Os 12 primeiros também são as testemunhas: juntos, tornam o teste
+// determinístico para todo n < 3.3 * 10^24, o que cobre todo uint64_t.
+constexpr uint64_t MR_SMALL_PRIMES[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+constexpr uint64_t MR_WITNESSES[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+/**
+ * Função: is_prime_mr
+ * -------------------
+ * Teste de primalidade determinístico de Miller-Rabin para n de 64 bits.
+ * Passos:
+ * 1. Descarta pares e múltiplos dos primos pequenos (a maioria dos compostos).
+ * 2. Escreve n - 1 = d * 2^s com d ímpar.
+ * 3. Para cada testemunha a: se a^d != 1 e a^(d*2^r) != -1 para todo r < s,
+ *    n é composto.
+ * Complexidade: O(log n) multiplicações modulares por testemunha.
+ */
+bool is_prime_mr(uint64_t n) {
+    if (n < 2) return false;
+    if (n % 2 == 0) return n == 2;
+    for (uint64_t p : MR_SMALL_PRIMES) {
+        if (n % p == 0) return n == p;
+    }
+    // Sem fatores até 53, qualquer n < 59^2 é primo
+    if (n < 59 * 59) return true;
+
+    uint64_t d = n - 1;
+    int s = 0;
+    while (d % 2 == 0) {
+        d /= 2;
+        s++;
+    }
+
+    const Montgomery64 mont(n);
+    const uint64_t minus_one = n - mont.one; // -1 na forma de Montgomery
+
+    for (uint64_t a : MR_WITNESSES) {
+        uint64_t x = mont.pow(mont.to_mont(a), d);
+        if (x == mont.one || x == minus_one) continue;
+
+        bool composite = true;
+        for (int r = 1; r < s; r++) {
+            x = mont.mul(x, x);
+            if (x == minus_one) {
+                composite = false;
+                break;
+            }
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+/**
+ * Função: count_primes_mr
+ * -----------------------
+ * Conta os primos de [start, end] testando apenas os ímpares com is_prime_mr.
+ * O custo por número é O(log n), então intervalos curtos e muito altos
+ * (ex.: [1e18, 1e18 + 1e7]) saem rápido, sem precisar de primos-base até sqrt(n).
+ */
+long long count_primes_mr(uint64_t start, uint64_t end) {
+    if (start > end) return 0;
+
+    long long prime_count = 0;
+    if (start <= 2 && end >= 2) prime_count++;
+    uint64_t first_odd = std::max<uint64_t>(start | 1, 3);
+    for (uint64_t i = first_odd; i <= end; i += 2) {
+        if (is_prime_mr(i)) prime_count++;
+    }
+    return prime_count;
+}
+
+// ==========================================
+// Divisão por Tentativas Vetorizada (SIMD)
+// ==========================================
+
+/**
+ * Teste de divisibilidade sem divisão (Granlund-Montgomery / Lemire): para
+ * d ímpar existe inv(d) com d * inv(d) ≡ 1 (mod 2^32), e para n < 2^32
+ *
+ *     d divide n  <=>  (uint32_t)(n * inv(d)) <= (2^32 - 1) / d
+ *
+ * Cada teste vira uma multiplicação de 32 bits e uma comparação, operações
+ * que existem em SIMD (a divisão inteira não existe). Os kernels testam 8
+ * (AVX2) ou 16 (AVX-512) ímpares consecutivos de uma vez contra o mesmo
+ * primo-base p, avançando p até p*p passar do maior candidato ou até todas
+ * as faixas estarem decididas.
+ *
+ * Os divisores são os primos ímpares até 65535, o que cobre n < 2^32. Acima
+ * disso, count_primes_simd recorre ao Miller-Rabin.
+ */
+constexpr uint32_t SIMD_DIVISOR_LIMIT = 65535;
+
+struct SimdDivisorTable {
+    std::vector<uint32_t> inverse; // inv(p) mod 2^32
+    std::vector<uint32_t> limit;   // (2^32 - 1) / p
+    std::vector<uint32_t> square;  // p * p (cabe em 32 bits: p <= 65535)
+};
+
+/**
+ * Função: simd_divisors
+ * ---------------------
+ * Tabela de divisores, construída uma única vez por processo. O inverso
+ * modular vem da iteração de Newton x <- x * (2 - p * x), que dobra os bits
+ * corretos a cada passo (3 -> 6 -> 12 -> 24 -> 48).
+ */
+const SimdDivisorTable& simd_divisors() {
+    static const SimdDivisorTable table = []() {
+        SimdDivisorTable t;
+        for (uint32_t p : sieve_base_primes(SIMD_DIVISOR_LIMIT)) {
+            uint32_t inv = p;
+            for (int k = 0; k < 4; k++) inv *= 2 - p * inv;
+            t.inverse.push_back(inv);
+            t.limit.push_back(UINT32_MAX / p);
+            t.square.push_back(p * p);
+        }
+        return t;
+    }();
+    return table;
+}
+
+/**
+ * Função: simd_count_scalar
+ * -------------------------
+ * Versão escalar do kernel (fallback e cauda dos lotes): conta os primos
+ * entre os 'count' ímpares first, first + 2, ... (first >= 3, todos < 2^32).
+ */
+long long simd_count_scalar(uint32_t first, uint64_t count) {
+    const SimdDivisorTable& t = simd_divisors();
+    long long primes = 0;
+    for (uint64_t k = 0; k < count; k++) {
+        uint32_t n = first + 2 * (uint32_t)k;
+        bool prime = true;
+        for (size_t j = 0; j < t.square.size() && t.square[j] <= n; j++) {
+            if (n * t.inverse[j] <= t.limit[j]) {
+                prime = false;
+                break;
+            }
+        }
+        primes += prime;
+    }
+    return primes;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Função: simd_count_avx2
+ * -----------------------
+ * Kernel AVX2: 8 candidatos por vetor. Sem comparação sem sinal no AVX2,
+ * "a <= b" é feito como min(a, b) == a.
+ */
+__attribute__((target("avx2")))
+long long simd_count_avx2(uint32_t first, uint64_t count) {
+    const SimdDivisorTable& t = simd_divisors();
+    const __m256i lane_offsets = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    long long primes = 0;
+    uint64_t k = 0;
+
+    for (; k + 8 <= count; k += 8) {
+        uint32_t base = first + 2 * (uint32_t)k;
+        __m256i n = _mm256_add_epi32(_mm256_set1_epi32((int)base), lane_offsets);
+        __m256i composite = _mm256_setzero_si256();
+        uint32_t largest = base + 14;
+
+        for (size_t j = 0; j < t.square.size() && t.square[j] <= largest; j++) {
+            __m256i square = _mm256_set1_epi32((int)t.square[j]);
+            __m256i limit = _mm256_set1_epi32((int)t.limit[j]);
+            __m256i product = _mm256_mullo_epi32(n, _mm256_set1_epi32((int)t.inverse[j]));
+            __m256i divides = _mm256_cmpeq_epi32(_mm256_min_epu32(product, limit), product);
+            __m256i in_range = _mm256_cmpeq_epi32(_mm256_min_epu32(square, n), square);
+            composite = _mm256_or_si256(composite, _mm256_and_si256(divides, in_range));
+            if (_mm256_movemask_ps(_mm256_castsi256_ps(composite)) == 0xFF) break;
+        }
+        primes += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(composite)));
+    }
+    return primes + simd_count_scalar(first + 2 * (uint32_t)k, count - k);
+}
+
+/**
+ * Função: simd_count_avx512
+ * -------------------------
+ * Kernel AVX-512: 16 candidatos por vetor, com comparações sem sinal que
+ * produzem máscaras de bits diretamente.
+ */
+__attribute__((target("avx512f")))
+long long simd_count_avx512(uint32_t first, uint64_t count) {
+    const SimdDivisorTable& t = simd_divisors();
+    const __m512i lane_offsets = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14,
+                                                   16, 18, 20, 22, 24, 26, 28, 30);
+    long long primes = 0;
+    uint64_t k = 0;
+
+    for (; k + 16 <= count; k += 16) {
+        uint32_t base = first + 2 * (uint32_t)k;
+        __m512i n = _mm512_add_epi32(_mm512_set1_epi32((int)base), lane_offsets);
+        __mmask16 composite = 0;
+        uint32_t largest = base + 30;
+
+        for (size_t j = 0; j < t.square.size() && t.square[j] <= largest; j++) {
+            __m512i product = _mm512_mullo_epi32(n, _mm512_set1_epi32((int)t.inverse[j]));
+            __mmask16 divides = _mm512_cmple_epu32_mask(product, _mm512_set1_epi32((int)t.limit[j]));
+            __mmask16 in_range = _mm512_cmple_epu32_mask(_mm512_set1_epi32((int)t.square[j]), n);
+            composite |= divides & in_range;
+            if (composite == 0xFFFF) break;
+        }
+        primes += 16 - __builtin_popcount(composite);
+    }
+    return primes + simd_count_scalar(first + 2 * (uint32_t)k, count - k);
+}
+#endif
+
+using SimdKernel = long long (*)(uint32_t, uint64_t);
+
+/**
+ * Função: simd_select
+ * -------------------
+ * Escolhe o kernel uma única vez por processo, pela detecção de recursos
+ * da CPU (AVX-512F > AVX2 > escalar). A variável de ambiente
+ * PRIMECOUNT_SIMD=avx512|avx2|scalar restringe a escolha (útil para
+ * comparar as variantes na mesma máquina). Devolve o nome do escolhido.
+ */
+const char* simd_select(SimdKernel* kernel) {
+    static SimdKernel chosen = simd_count_scalar;
+    static const char* name = []() {
+        const char* wanted = getenv("PRIMECOUNT_SIMD");
+        std::string limit = wanted ? wanted : "avx512";
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (limit == "avx512" && __builtin_cpu_supports("avx512f")) {
+            chosen = simd_count_avx512;
+            return "avx512";
+        }
+        if ((limit == "avx512" || limit == "avx2") && __builtin_cpu_supports("avx2")) {
+            chosen = simd_count_avx2;
+            return "avx2";
+        }
+#endif
+        return "scalar";
+    }();
+    if (kernel != nullptr) *kernel = chosen;
+    return name;
+}
+
+/**
+ * Função: count_primes_simd
+ * -------------------------
+ * Conta os primos de [start, end] com o kernel SIMD escolhido. Apenas os
+ * ímpares são testados; a parte do intervalo >= 2^32 usa Miller-Rabin.
+ */
+long long count_primes_simd(uint64_t start, uint64_t end) {
+    if (end < 2 || start > end) return 0;
+
+    long long prime_count = 0;
+    if (start <= 2) {
+        prime_count = 1;
+        start = 3;
+    }
+    if (start % 2 == 0) start++;
+
+    uint64_t small_end = std::min<uint64_t>(end, UINT32_MAX);
+    if (start <= small_end) {
+        SimdKernel kernel = nullptr;
+        simd_select(&kernel);
+        prime_count += kernel((uint32_t)start, (small_end - start) / 2 + 1);
+    }
+    if (end > UINT32_MAX) {
+        prime_count += count_primes_mr(std::max<uint64_t>(start, (uint64_t)UINT32_MAX + 1), end);
+    }
+    return prime_count;
+}
+
+// ==========================================
+// Contagem Sublinear de pi(x): Lagarias-Miller-Odlyzko
+// ==========================================
+
+// Tarefa sobre um subintervalo [start, end] cujo resultado é aditivo entre
+// blocos disjuntos (ex.: contagem de primos, soma ponderada de primos).
+using RangeKernel = std::function<long long(uint64_t start, uint64_t end)>;
+
+// Executor de uma RangeKernel sobre [start, end]. Permite que a fase de crivo
+// do LMO rode em sequência, em P processos (run_concurrent) ou em P threads.
+using RangeExecutor = std::function<long long(uint64_t start, uint64_t end,
+                                              const RangeKernel& kernel)>;
+
+// Abaixo deste x, o crivo direto é mais simples e igualmente rápido
+constexpr uint64_t LMO_MIN_X = 100000;
+
+// O crivo de S2 usa blocos de 2^18 números (32 KiB em bits, cabe na L1d),
+// com um contador de bits livres a cada 4096 números (64 palavras)
+constexpr uint64_t LMO_SEGMENT_SIZE = 1 << 18;
+constexpr uint64_t LMO_COUNTER_SPAN = 4096;
+
+/**
+ * Função: icbrt_u64
+ * -----------------
+ * Raiz cúbica inteira (piso) de n, exata para todo uint64_t.
+ */
+uint64_t icbrt_u64(uint64_t n) {
+    uint64_t root = (uint64_t)std::cbrt((double)n);
+    while (root > 0 && root * root * root > n) root--;
+    while ((root + 1) * (root + 1) * (root + 1) <= n) root++;
+    return root;
+}
+
+/**
+ * Estrutura: LmoSieveSegment
+ * --------------------------
+ * Segmento [low, low + size) do crivo usado para calcular phi(z, b) nas
+ * folhas especiais. Guarda um bit por número (1 = ainda não riscado) e um
+ * contador por bloco de LMO_COUNTER_SPAN números, de modo que:
+ * - riscar um número custa O(1) (limpa o bit e decrementa o contador);
+ * - contar os bits até z com z crescente (ordem natural das folhas de um
+ *   mesmo primo) avança um cursor, pulando blocos inteiros pelos contadores.
+ */
+struct LmoSieveSegment {
+    uint64_t low = 0;
+    uint64_t size = 0;
+    long long alive = 0;               // Bits ainda ligados no segmento
+    std::vector<uint64_t> bits;
+    std::vector<int32_t> block_count;
+
+    // Cursor monotônico de contagem: 'cursor_count' bits ligados em [low, low + cursor)
+    uint64_t cursor = 0;
+    long long cursor_count = 0;
+
+    void reset(uint64_t new_low, uint64_t new_size) {
+        low = new_low;
+        size = new_size;
+        alive = (long long)size;
+        bits.assign((size + 63) / 64, ~0ULL);
+        if (size % 64 != 0) bits.back() = (1ULL << (size % 64)) - 1;
+        block_count.assign((size + LMO_COUNTER_SPAN - 1) / LMO_COUNTER_SPAN, 0);
+        for (uint64_t i = 0; i < size; i += LMO_COUNTER_SPAN) {
+            block_count[i / LMO_COUNTER_SPAN] = (int32_t)std::min(LMO_COUNTER_SPAN, size - i);
+        }
+    }
+
+    // Risca todos os múltiplos de p no segmento
+    void cross_off(uint64_t p) {
+        for (uint64_t j = (low + p - 1) / p * p - low; j < size; j += p) {
+            uint64_t mask = 1ULL << (j % 64);
+            if (bits[j / 64] & mask) {
+                bits[j / 64] &= ~mask;
+                block_count[j / LMO_COUNTER_SPAN]--;
+                alive--;
+            }
+        }
+    }
+
+    void rewind() {
+        cursor = 0;
+        cursor_count = 0;
+    }
+
+    // Quantidade de números não riscados em [low, z]; z não pode diminuir até o próximo rewind()
+    long long count_upto(uint64_t z) {
+        uint64_t target = z - low + 1;
+        while (cursor % LMO_COUNTER_SPAN == 0 && cursor + LMO_COUNTER_SPAN <= target) {
+            cursor_count += block_count[cursor / LMO_COUNTER_SPAN];
+            cursor += LMO_COUNTER_SPAN;
+        }
+        while (cursor + 64 <= target) {
+            cursor_count += __builtin_popcountll(bits[cursor / 64]);
+            cursor += 64;
+        }
+        uint64_t partial = target - cursor;
+        if (partial == 0) return cursor_count;
+        return cursor_count + __builtin_popcountll(bits[cursor / 64] & ((1ULL << partial) - 1));
+    }
+};
+
+/**
+ * Função: pi_lmo
+ * --------------
+ * Calcula pi(x) com o método combinatório de Lagarias-Miller-Odlyzko, sem
+ * enumerar todos os números até x. Com y = cbrt(x) e a = pi(y):
+ *
+ *   pi(x) = phi(x, a) + a - 1 - P2(x, a)
+ *
+ * - phi(x, a) conta os n <= x sem fatores primos <= p_a. Pela expansão de
+ *   Legendre truncada, phi(x, a) = S1 + S2:
+ *   - S1 (folhas ordinárias): soma de mu(n) * floor(x/n) para n <= y;
+ *   - S2 (folhas especiais): -mu(m) * phi(x/(p_{b+1} m), b) para m <= y < p_{b+1} m
+ *     e lpf(m) > p_{b+1}. Os valores de phi vêm de um crivo segmentado sobre
+ *     [1, x/y], riscando um primo por vez e acumulando phi[b] entre segmentos.
+ * - P2(x, a) conta os n <= x com exatamente dois fatores primos > p_a:
+ *   soma de pi(x/p_b) - (b - 1) para y < p_b <= sqrt(x). Os pi(x/p_b) saem
+ *   de uma única passada de crivo até x/p_{a+1}, em que cada primo q pesa
+ *   #{b : x/p_b >= q}. Essa passada é aditiva por blocos e roda no 'executor'
+ *   (sequencial, P processos ou P threads).
+ *
+ * Complexidade: O(x^(2/3)) de tempo e O(x^(1/3)) de memória, além da tabela
+ * de primos até sqrt(x).
+ */
+long long pi_lmo(uint64_t x, const RangeExecutor& executor) {
+    if (x < LMO_MIN_X) return count_primes_sieve(2, x);
+
+    uint64_t y = icbrt_u64(x);
+    uint64_t sqrt_x = isqrt_u64(x);
+
+    // primes[1..] = primos até sqrt(x) (índice a partir de 1, como na literatura)
+    std::vector<uint32_t> primes = {0, 2};
+    std::vector<uint32_t> odd_primes = sieve_base_primes((uint32_t)sqrt_x);
+    primes.insert(primes.end(), odd_primes.begin(), odd_primes.end());
+    uint64_t a = std::upper_bound(primes.begin() + 1, primes.end(), y) - (primes.begin() + 1);
+    uint64_t b_max = primes.size() - 1; // pi(sqrt(x))
+
+    // Möbius mu(n) e menor fator primo lpf(n) para n <= y
+    std::vector<int8_t> mu(y + 1, 1);
+    std::vector<uint32_t> lpf(y + 1, 0);
+    lpf[1] = UINT32_MAX;
+    for (uint64_t b = 1; b <= a; b++) {
+        uint64_t p = primes[b];
+        for (uint64_t m = p; m <= y; m += p) {
+            if (lpf[m] == 0) lpf[m] = (uint32_t)p;
+            mu[m] = (int8_t)-mu[m];
+        }
+        for (uint64_t m = p * p; m <= y; m += p * p) mu[m] = 0;
+    }
+
+    // S1: folhas ordinárias
+    uint128_t s1_pos = 0, s1_neg = 0;
+    for (uint64_t n = 1; n <= y; n++) {
+        if (mu[n] > 0) s1_pos += x / n;
+        else if (mu[n] < 0) s1_neg += x / n;
+    }
+
+    // S2: folhas especiais, via crivo segmentado de [1, x/y]
+    uint64_t limit = x / y;
+    std::vector<long long> phi(a + 1, 0); // phi[b]: não riscados por p_1..p_b nos segmentos anteriores
+    uint128_t s2_pos = 0, s2_neg = 0;
+    LmoSieveSegment segment;
+
+    for (uint64_t low = 1; low <= limit; low += LMO_SEGMENT_SIZE) {
+        uint64_t high = std::min(low + LMO_SEGMENT_SIZE, limit + 1); // exclusivo
+        segment.reset(low, high - low);
+        uint64_t x_div_low = x / low;
+        uint64_t x_div_high = x / high;
+
+        for (uint64_t b = 0; b < a; b++) {
+            if (b > 0) segment.cross_off(primes[b]);
+
+            uint64_t p = primes[b + 1];
+            // Uma folha exige m > p e p*m <= x/low; se p^2 > x/low não há
+            // folhas neste nem nos próximos segmentos, e phi[b..] não é mais usado
+            if (p * p > x_div_low) break;
+
+            // Folhas com z = x/(p*m) em [low, high): m em (x/(high*p), x/(low*p)], m > y/p
+            uint64_t m_first = std::min(y, x_div_low / p);
+            uint64_t m_stop = std::max(y / p, x_div_high / p);
+            segment.rewind();
+            for (uint64_t m = m_first; m > m_stop; m--) {
+                if (mu[m] == 0 || lpf[m] <= p) continue;
+                uint64_t z = x / (p * m); // cresce à medida que m diminui
+                long long phi_z = phi[b] + segment.count_upto(z);
+                if (mu[m] > 0) s2_neg += (uint64_t)phi_z;
+                else s2_pos += (uint64_t)phi_z;
+            }
+
+            phi[b] += segment.alive;
+        }
+    }
+
+    // P2: z_b = x/p_b em ordem crescente, para b de pi(sqrt(x)) até a + 1
+    std::vector<uint64_t> z_values;
+    for (uint64_t b = b_max; b > a; b--) z_values.push_back(x / primes[b]);
+
+    long long p2 = 0;
+    if (!z_values.empty()) {
+        RangeKernel weighted = [&z_values](uint64_t start, uint64_t end) -> long long {
+            // Cada primo q contribui com #{b : z_b >= q}
+            std::size_t idx = std::lower_bound(z_values.begin(), z_values.end(), start) - z_values.begin();
+            long long sum = 0;
+            for_each_prime_sieve(start, end, [&](uint64_t q) {
+                while (idx < z_values.size() && z_values[idx] < q) idx++;
+                sum += (long long)(z_values.size() - idx);
+            });
+            return sum;
+        };
+        long long sum_pi = executor(2, z_values.back(), weighted);
+        // Soma de (b - 1) para b = a+1 .. pi(sqrt(x))
+        long long sum_index = (long long)((b_max - 1) * b_max / 2 - (a - 1) * a / 2);
+        p2 = sum_pi - sum_index;
+    }
+
+    uint128_t phi_x_a = s1_pos + s2_pos - s1_neg - s2_neg;
+    return (long long)phi_x_a + (long long)a - 1 - p2;
+}
+
+/**
+ * Função: count_primes_lmo
+ * ------------------------
+ * Conta os primos de [start, end] como pi_lmo(end) - pi_lmo(start - 1).
+ */
+long long count_primes_lmo(uint64_t start, uint64_t end, const RangeExecutor& executor) {
+    if (end < 2 || start > end) return 0;
+    long long below = (start > 2) ? pi_lmo(start - 1, executor) : 0;
+    return pi_lmo(end, executor) - below;
+}
+
+// Executor sequencial: aplica a tarefa diretamente sobre o intervalo inteiro
+long long run_kernel_inline(uint64_t start, uint64_t end, const RangeKernel& kernel) {
+    return kernel(start, end);
+}
+
+/**
+ * Função: count_primes_interval
+ * -----------------------------
+ * Conta quantos números primos existem em um intervalo fechado [start, end].
+ * Esta é a "tarefa de trabalho" que será executada tanto pelo modo
+ * sequencial quanto pelos processos filhos (workers) no modo paralelo.
+ * O parâmetro 'algo' seleciona o motor: "basic" (divisão por tentativas),
+ * "sieve" (crivo segmentado), "mr" (Miller-Rabin determinístico) ou
+ * "lmo" (pi(x) sublinear, em um único processo) ou "simd" (divisão por
+ * tentativas vetorizada).
+ */
+long long count_primes_interval(uint64_t start, uint64_t end, const std::string& algo) {
+    if (algo == "sieve") {
+        return count_primes_sieve(start, end);
+    }
+    if (algo == "mr") {
+        return count_primes_mr(start, end);
+    }
+    if (algo == "lmo") {
+        return count_primes_lmo(start, end, run_kernel_inline);
+    }
+    if (algo == "simd") {
+        return count_primes_simd(start, end);
+    }
+    return count_primes_basic(start, end);
+}
+
+/**
+ * Função: is_valid_algo
+ * ---------------------
+ * Indica se 'algo' é um dos motores aceitos por count_primes_interval.
+ */
+bool is_valid_algo(const std::string& algo) {
+    return algo == "basic" || algo == "sieve" || algo == "mr" || algo == "lmo" || algo == "simd";
+}
+
+/**
+ * Função: is_valid_sched
+ * ----------------------
+ * Indica se 'sched' é uma das divisões de intervalo aceitas por run_concurrent.
+ */
+bool is_valid_sched(const std::string& sched) {
+    return sched == "static" || sched == "dynamic" || sched == "guided";
+}
+
 // ==========================================
 // Implementação SEQUENCIAL
 // ==========================================
 
 /**
- * Função: run_sequential
- * ----------------------
- * Executa a contagem de primos em um único processo (sem paralelismo).
- * Serve como linha de base (baseline) para comparar o ganho de desempenho
- * da versão concorrente.
+ * Função: run_sequential
+ * ----------------------
+ * Executa a contagem de primos em um único processo (sem paralelismo).
+ * Serve como linha de base (baseline) para comparar o ganho de desempenho
+ * da versão concorrente.
+ */
+long long run_sequential(uint64_t from, uint64_t N, const std::string& algo) {
+    // Conta primos no intervalo completo [from, N] (from = 2 por padrão)
+    return count_primes_interval(from, N, algo);
+}
+
+// ==========================================
+// PARTE C: Implementação CONCORRENTE
+// ==========================================
+
+/**
+ * Estrutura: RunOptions
+ * ---------------------
+ * Opções de execução lidas da linha de comando e repassadas aos workers.
+ */
+struct RunOptions {
+    std::string algo = "basic";   // Motor de contagem: "basic", "sieve", "mr", "lmo" ou "simd"
+    std::string sched = "static"; // Divisão do intervalo: "static", "dynamic" ou "guided"
+    uint64_t chunk = 0;           // Tamanho do bloco (dynamic) ou bloco mínimo (guided); 0 = automático
+    uint64_t blocks_per_worker = 32; // Blocos por worker quando chunk = 0 (ajustado pelo tune)
+    bool stats = false;           // --stats: instrumentação por worker em run_concurrent
+    std::string trace_path;       // --trace: timeline no formato Chrome Trace (implica --stats)
+    bool progress = false;        // --progress: andamento e ETA (IPC futex/eventfd)
+    std::string pin;              // --pin: "compact", "scatter" ou lista de CPUs; vazio = sem pinning
+    std::vector<int> pin_cpus;    // CPU de cada worker, calculada por plan_affinity
+};
+
+/**
+ * Estrutura: WorkerStats
+ * ----------------------
+ * Instrumentação de um worker de run_concurrent (--stats). Os campos
+ * start_ns/end_ns/tested/primes são medidos pelo próprio worker e voltam ao
+ * master pelo mesmo canal do resultado (pipe ou SHM); fork_ns é anotado pelo
+ * master logo antes do fork e cpu_ns/max_rss_kb vêm do rusage do wait4.
+ * Os tempos usam CLOCK_MONOTONIC, que é comum a todos os processos.
+ */
+struct WorkerStats {
+    int64_t fork_ns = 0;     // Instante do fork (master)
+    int64_t start_ns = 0;    // Início do trabalho (worker)
+    int64_t end_ns = 0;      // Fim do trabalho (worker)
+    int64_t exit_ns = 0;     // Instante em que o master reaproveitou o filho (wait4)
+    uint64_t tested = 0;     // Números do intervalo processados
+    long long primes = 0;    // Primos encontrados
+    int64_t cpu_ns = 0;      // Tempo de CPU (usuário + sistema), do rusage
+    long max_rss_kb = 0;     // Pico de memória residente, do rusage
+    pid_t pid = 0;
+};
+
+/**
+ * Função: now_ns
+ * --------------
+ * Instante atual de CLOCK_MONOTONIC em nanossegundos.
+ */
+int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Função: apply_affinity
+ * ----------------------
+ * Fixa o processo (ou a thread) chamador na CPU planejada para o worker
+ * 'index' (ver plan_affinity). Sem --pin, não faz nada. Deve ser chamada
+ * antes de o worker alocar os seus buffers, para que eles nasçam no nó
+ * NUMA do núcleo escolhido.
+ */
+void apply_affinity(const RunOptions& opts, int index) {
+    if (opts.pin_cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(opts.pin_cpus[index % opts.pin_cpus.size()], &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("Erro no sched_setaffinity");
+    }
+}
+
+/**
+ * Estrutura: SharedControl
+ * ------------------------
+ * Cabeçalho da região compartilhada (mmap) usado pelo escalonamento dinâmico.
+ * 'next_start' é o cursor do próximo número ainda não atribuído: cada worker
+ * reivindica um bloco [next_start, next_start + tamanho) com uma operação
+ * atômica, sem locks, até o intervalo se esgotar.
+ * Ocupa uma linha de cache inteira para não compartilhá-la com os resultados.
+ * 'wakeups' é a palavra de futex do IPC "futex": cada publicação de um
+ * worker a incrementa e acorda o master (fica em outra linha de cache,
+ * longe do cursor disputado pelos workers).
+ */
+struct alignas(64) SharedControl {
+    std::atomic<uint64_t> next_start;
+    alignas(64) std::atomic<uint32_t> wakeups;
+};
+
+/**
+ * Estrutura: ProgressSlot
+ * -----------------------
+ * Placar de um worker nos IPCs com notificação ("futex" e "eventfd"): o
+ * worker atualiza os totais acumulados a cada bloco concluído e marca
+ * 'done' ao terminar; o master lê os slots enquanto os workers ainda
+ * trabalham. Um slot por linha de cache, para evitar false sharing.
+ */
+struct alignas(64) ProgressSlot {
+    std::atomic<long long> primes;
+    std::atomic<uint64_t> tested;
+    std::atomic<uint32_t> done;
+};
+
+// Atômicos em memória MAP_SHARED só funcionam entre processos se forem lock-free
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "std::atomic<uint64_t> precisa ser lock-free para uso entre processos");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "a palavra de futex precisa ter exatamente 32 bits");
+
+/**
+ * Função: notify_master
+ * ---------------------
+ * Avisa o master de que um slot de progresso mudou: com eventfd, soma 1 ao
+ * contador do descritor; com futex, incrementa a palavra compartilhada e
+ * acorda quem estiver esperando nela (FUTEX_WAKE sem a flag PRIVATE, pois
+ * a espera é entre processos).
+ */
+void notify_master(SharedControl* control, int event_fd) {
+    if (event_fd >= 0) {
+        uint64_t one = 1;
+        if (write(event_fd, &one, sizeof(one)) == -1) perror("Erro na escrita do eventfd");
+        return;
+    }
+    control->wakeups.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, (uint32_t*)&control->wakeups, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/**
+ * Função: wait_for_update
+ * -----------------------
+ * Bloqueia o master até algum worker publicar progresso ou até
+ * 'timeout_ms' passar. No futex, 'seen' guarda o último valor observado da
+ * palavra: FUTEX_WAIT só dorme se ela ainda valer 'seen', o que impede
+ * perder um aviso dado entre a leitura e a espera.
+ */
+void wait_for_update(SharedControl* control, int event_fd, uint32_t& seen, int timeout_ms) {
+    if (event_fd >= 0) {
+        struct pollfd pfd = {event_fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) > 0) {
+            uint64_t events = 0;
+            if (read(event_fd, &events, sizeof(events)) == -1 && errno != EAGAIN) {
+                perror("Erro na leitura do eventfd");
+            }
+        }
+        return;
+    }
+    uint32_t current = control->wakeups.load(std::memory_order_acquire);
+    if (current == seen) {
+        struct timespec timeout = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L};
+        syscall(SYS_futex, (uint32_t*)&control->wakeups, FUTEX_WAIT, seen, &timeout, NULL, 0);
+        current = control->wakeups.load(std::memory_order_acquire);
+    }
+    seen = current;
+}
+
+/**
+ * Função: resolve_chunk_size
+ * --------------------------
+ * Retorna o tamanho de bloco efetivo: o valor de --chunk, ou, se omitido,
+ * cerca de 'blocks_per_worker' blocos por worker (32 por padrão, com mínimo
+ * de 4096 números), o que dilui o custo de reivindicação sem voltar ao
+ * desbalanceamento das fatias fixas.
+ */
+uint64_t resolve_chunk_size(uint64_t total_numbers, int P, uint64_t requested,
+                            uint64_t blocks_per_worker = 32) {
+    if (requested > 0) return requested;
+    return std::max<uint64_t>(total_numbers / ((uint64_t)P * blocks_per_worker), 4096);
+}
+
+/**
+ * Função: claim_chunk
+ * -------------------
+ * Reivindica o próximo bloco de trabalho no cursor compartilhado.
+ * - dynamic: blocos de tamanho fixo 'chunk' (fetch_add).
+ * - guided:  blocos de tamanho restante/(2P), nunca menores que 'chunk',
+ *            que começam grandes e diminuem perto do fim (CAS).
+ * Retorna false quando o intervalo [.., N] já foi totalmente distribuído.
+ */
+bool claim_chunk(SharedControl* control, uint64_t N, int P, const std::string& sched,
+                 uint64_t chunk, uint64_t& chunk_start, uint64_t& chunk_end) {
+    if (sched == "dynamic") {
+        // A leitura prévia evita que o cursor continue avançando (e transborde)
+        // depois que o intervalo já se esgotou
+        if (control->next_start.load(std::memory_order_relaxed) > N) return false;
+        chunk_start = control->next_start.fetch_add(chunk, std::memory_order_relaxed);
+        if (chunk_start > N) return false;
+        chunk_end = std::min<uint64_t>(chunk_start + chunk - 1, N);
+        return true;
+    }
+
+    // guided
+    uint64_t current = control->next_start.load(std::memory_order_relaxed);
+    while (current <= N) {
+        uint64_t remaining = N - current + 1;
+        uint64_t size = std::max<uint64_t>(chunk, remaining / (2ULL * P));
+        if (control->next_start.compare_exchange_weak(current, current + size,
+                                                      std::memory_order_relaxed)) {
+            chunk_start = current;
+            chunk_end = std::min<uint64_t>(current + size - 1, N);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Função: worker_count
+ * --------------------
+ * Trabalho de um worker: no modo 'static' aplica a tarefa à sua fatia fixa
+ * [slice_start, slice_end]; nos modos 'dynamic'/'guided' ignora a fatia e
+ * reivindica blocos no cursor compartilhado até o intervalo acabar.
+ * Em 'tested' devolve quantos números o worker processou. Se 'on_block'
+ * for dado (IPCs com notificação), a fatia estática também é percorrida em
+ * blocos de 'chunk' números, e on_block(primos, testados) recebe os totais
+ * acumulados após cada bloco.
+ */
+long long worker_count(uint64_t slice_start, uint64_t slice_end, uint64_t N, int P,
+                       const RunOptions& opts, uint64_t chunk, SharedControl* control,
+                       const RangeKernel& kernel, uint64_t& tested,
+                       const std::function<void(long long, uint64_t)>& on_block = nullptr) {
+    long long primes_found = 0;
+    tested = 0;
+
+    if (opts.sched == "static") {
+        if (!on_block) {
+            tested = slice_end - slice_start + 1;
+            return kernel(slice_start, slice_end);
+        }
+        for (uint64_t start = slice_start; start <= slice_end; start += chunk) {
+            uint64_t end = std::min<uint64_t>(start + (chunk - 1), slice_end);
+            primes_found += kernel(start, end);
+            tested += end - start + 1;
+            on_block(primes_found, tested);
+            if (end == slice_end) break;
+        }
+        return primes_found;
+    }
+
+    uint64_t chunk_start = 0, chunk_end = 0;
+    while (claim_chunk(control, N, P, opts.sched, chunk, chunk_start, chunk_end)) {
+        primes_found += kernel(chunk_start, chunk_end);
+        tested += chunk_end - chunk_start + 1;
+        if (on_block) on_block(primes_found, tested);
+    }
+    return primes_found;
+}
+
+/**
+ * Função: print_progress
+ * ----------------------
+ * Linha de progresso de --progress (stderr, reescrita com '\r'): fração do
+ * intervalo já testada, primos encontrados até agora e estimativa do tempo
+ * restante, extrapolando a taxa média observada.
+ */
+void print_progress(uint64_t tested, uint64_t total, long long primes, int64_t elapsed_ns) {
+    double fraction = total > 0 ? (double)tested / total : 1.0;
+    double elapsed_s = elapsed_ns / 1e9;
+    double eta_s = fraction > 0 ? elapsed_s * (1.0 - fraction) / fraction : 0.0;
+    fprintf(stderr, "\rprogresso: %5.1f%% primos=%lld decorrido=%.1fs eta=%.1fs   ",
+            fraction * 100.0, primes, elapsed_s, eta_s);
+    fflush(stderr);
+}
+
+/**
+ * Função: print_worker_stats
+ * --------------------------
+ * Imprime em stderr a tabela por worker de --stats e o resumo da execução:
+ * - latência de fork: do fork() no master ao início do trabalho no filho;
+ * - desbalanceamento: maior tempo ocupado / tempo ocupado médio (1.00 = perfeito);
+ * - espera: do último fork até o último filho ser reaproveitado;
+ * - agregação: leitura e soma dos resultados parciais pelo master.
+ */
+void print_worker_stats(const std::vector<WorkerStats>& stats, int64_t t0_ns,
+                        int64_t wait_ns, int64_t aggregation_ns) {
+    char line[256];
+    fprintf(stderr, "%-6s %-8s %10s %10s %10s %10s %10s %14s %12s %10s\n",
+            "worker", "pid", "fork_ms", "start_ms", "end_ms", "busy_ms", "cpu_ms",
+            "tested", "primes", "rss_kb");
+
+    double busy_sum = 0, busy_max = 0, fork_lat_sum = 0, fork_lat_max = 0;
+    for (size_t i = 0; i < stats.size(); i++) {
+        const WorkerStats& w = stats[i];
+        double busy_ms = (w.end_ns - w.start_ns) / 1e6;
+        double fork_lat_ms = (w.start_ns - w.fork_ns) / 1e6;
+        busy_sum += busy_ms;
+        busy_max = std::max(busy_max, busy_ms);
+        fork_lat_sum += fork_lat_ms;
+        fork_lat_max = std::max(fork_lat_max, fork_lat_ms);
+
+        snprintf(line, sizeof(line), "%-6zu %-8d %10.3f %10.3f %10.3f %10.3f %10.3f %14llu %12lld %10ld\n",
+                 i, (int)w.pid, (w.fork_ns - t0_ns) / 1e6, (w.start_ns - t0_ns) / 1e6,
+                 (w.end_ns - t0_ns) / 1e6, busy_ms, w.cpu_ns / 1e6,
+                 (unsigned long long)w.tested, w.primes, w.max_rss_kb);
+        fputs(line, stderr);
+    }
+
+    double busy_mean = busy_sum / stats.size();
+    fprintf(stderr, "stats: fork_latency_ms mean=%.3f max=%.3f imbalance=%.2f wait_ms=%.3f aggregation_ms=%.3f\n",
+            fork_lat_sum / stats.size(), fork_lat_max,
+            busy_mean > 0 ? busy_max / busy_mean : 1.0, wait_ns / 1e6, aggregation_ns / 1e6);
+}
+
+/**
+ * Função: write_chrome_trace
+ * --------------------------
+ * Grava a timeline da execução no formato Chrome Trace Event (JSON), que
+ * pode ser aberto em chrome://tracing ou ui.perfetto.dev. Cada worker vira
+ * uma trilha com as fases "fork" (do fork ao início), "work" e "exit"
+ * (do fim do trabalho até o master reaproveitá-lo); o master ganha a fase
+ * "aggregate".
+ */
+void write_chrome_trace(const std::string& path, const std::vector<WorkerStats>& stats,
+                        int64_t t0_ns, int64_t aggregate_begin_ns, int64_t aggregate_end_ns) {
+    FILE* out = fopen(path.c_str(), "w");
+    if (out == nullptr) {
+        perror("Erro ao criar arquivo de trace");
+        return;
+    }
+
+    auto span = [&](const char* name, int tid, int64_t begin_ns, int64_t end_ns, const char* sep) {
+        fprintf(out, "  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+                     "\"ts\": %.3f, \"dur\": %.3f}%s\n",
+                name, tid, (begin_ns - t0_ns) / 1e3, std::max<int64_t>(end_ns - begin_ns, 0) / 1e3, sep);
+    };
+
+    fprintf(out, "{\"traceEvents\": [\n");
+    fprintf(out, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, "
+                 "\"args\": {\"name\": \"master\"}},\n");
+    for (size_t i = 0; i < stats.size(); i++) {
+        const WorkerStats& w = stats[i];
+        int tid = (int)i + 1;
+        fprintf(out, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, "
+                     "\"args\": {\"name\": \"worker %zu (pid %d)\"}},\n", tid, i, (int)w.pid);
+        span("fork", tid, w.fork_ns, w.start_ns, ",");
+        fprintf(out, "  {\"name\": \"work\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+                     "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"tested\": %llu, \"primes\": %lld}},\n",
+                tid, (w.start_ns - t0_ns) / 1e3, (w.end_ns - w.start_ns) / 1e3,
+                (unsigned long long)w.tested, w.primes);
+        span("exit", tid, w.end_ns, w.exit_ns, ",");
+    }
+    span("aggregate", 0, aggregate_begin_ns, aggregate_end_ns, "");
+    fprintf(out, "]}\n");
+    fclose(out);
+}
+
+/**
+ * Função: default_kernel
+ * ----------------------
+ * Tarefa padrão dos workers: contar os primos do bloco com o algoritmo escolhido.
+ */
+RangeKernel default_kernel(const RunOptions& opts) {
+    return [&opts](uint64_t start, uint64_t end) {
+        return count_primes_interval(start, end, opts.algo);
+    };
+}
+
+/**
+ * Função: run_concurrent
+ * ----------------------
+ * Gerencia a execução concorrente utilizando múltiplos processos.
+ * Passos principais:
+ * 1. Divide o intervalo total de busca de primos entre os processos.
+ * 2. Configura o mecanismo de comunicação (Pipe ou Memória Compartilhada).
+ * 3. Cria processos filhos (fork), um por fatia de intervalo.
+ * 4. Cada filho calcula a quantidade de primos em sua fatia.
+ * 5. O processo pai sincroniza, coleta e agrega os resultados parciais.
+ * Com --sched dynamic/guided, o passo 1 é substituído por um cursor atômico
+ * na região compartilhada, do qual os workers reivindicam blocos sob demanda.
+ * Com IPC "futex" ou "eventfd", os workers publicam totais parciais em
+ * slots compartilhados a cada bloco e avisam o master, que agrega à medida
+ * que os resultados chegam (sem esperar o filho mais lento), reaproveita
+ * os filhos com waitid conforme terminam e, com --progress, mostra o
+ * andamento e a estimativa de término.
+ * 'kernel' é a tarefa aplicada a cada bloco (padrão: contar primos). Com
+ * --algo lmo, o intervalo não é fatiado: pi_lmo roda no master e só a sua
+ * fase de crivo (P2) é distribuída, chamando run_concurrent de volta.
+ */
+long long run_concurrent(uint64_t from, uint64_t N, int P, const std::string& ipc_type,
+                         const RunOptions& opts, const RangeKernel& kernel = RangeKernel()) {
+    if (!kernel) {
+        if (opts.algo == "lmo") {
+            return count_primes_lmo(from, N, [&](uint64_t start, uint64_t end, const RangeKernel& task) {
+                return run_concurrent(start, end, P, ipc_type, opts, task);
+            });
+        }
+        return run_concurrent(from, N, P, ipc_type, opts, default_kernel(opts));
+    }
+
+    // ---------------------------------------------------------
+    // 1. Definição dos Intervalos (Balanceamento de Carga)
+    // ---------------------------------------------------------
+    // O intervalo de interesse é [from, N] (from = 2 por padrão).
+    uint64_t total_numbers = N - from + 1;        // Quantidade total de números a verificar
+    uint64_t base_chunk_size = total_numbers / P; // Tamanho base da fatia para cada processo
+    uint64_t extra_numbers = total_numbers % P;   // Números "a mais" distribuídos entre os primeiros processos
+
+    // ---------------------------------------------------------
+    // 2. Setup do IPC (Inter-Process Communication)
+    // ---------------------------------------------------------
+    int** ipc_pipes = nullptr;      // Matriz para armazenar descritores de arquivo (se usar Pipe)
+    long long* shared_results = nullptr;  // Ponteiro para a memória compartilhada (se usar SHM)
+    SharedControl* control = nullptr;     // Cursor de blocos (se sched != static)
+    WorkerStats* shared_stats = nullptr;  // Estatísticas por worker (se SHM/notificação e --stats)
+    ProgressSlot* progress = nullptr;     // Placar por worker (se futex/eventfd)
+    void* shared_region = nullptr;        // Região mmap: [SharedControl][resultados ou placar][estatísticas]
+    size_t shared_size = 0;
+    bool stats = opts.stats || !opts.trace_path.empty();
+    bool notify = (ipc_type == "futex" || ipc_type == "eventfd");
+    int event_fd = -1;
+
+    uint64_t chunk = resolve_chunk_size(total_numbers, P, opts.chunk, opts.blocks_per_worker);
+    bool dynamic_sched = (opts.sched != "static");
+
+    if (ipc_type != "pipe" && ipc_type != "shm" && !notify) {
+        std::cerr << "IPC invalido (use 'pipe', 'shm', 'futex' ou 'eventfd')" << std::endl;
+        exit(1);
+    }
+
+    if (dynamic_sched || ipc_type != "pipe") {
+        // Configura Memória Compartilhada usando mmap.
+        // MAP_SHARED: As alterações são visíveis para outros processos mapeando a mesma região.
+        // MAP_ANONYMOUS: A memória não é baseada em arquivo, é criada na RAM e zerada.
+        // PROT_READ | PROT_WRITE: Permissão de leitura e escrita.
+        // O cabeçalho de controle vem primeiro; no modo SHM, os P contadores vêm em seguida
+        // (nos modos com notificação, os P slots de progresso), seguidos das P estruturas
+        // de estatísticas quando --stats está ativo.
+        shared_size = sizeof(SharedControl);
+        if (ipc_type == "shm") shared_size += sizeof(long long) * P;
+        if (notify) shared_size += sizeof(ProgressSlot) * P;
+        if (ipc_type != "pipe" && stats) shared_size += sizeof(WorkerStats) * P;
+        shared_region = map_pages(shared_size, true);
+
+        if (shared_region == MAP_FAILED) {
+            perror("Erro no mmap");
+            exit(1);
+        }
+
+        control = new (shared_region) SharedControl();
+        control->next_start.store(from); // Primeiro número do intervalo [from, N]
+        char* next_field = (char*)shared_region + sizeof(SharedControl);
+        if (ipc_type == "shm") {
+            shared_results = (long long*)next_field;
+            next_field += sizeof(long long) * P;
+        }
+        if (notify) {
+            progress = (ProgressSlot*)next_field;
+            for (int i = 0; i < P; i++) new (&progress[i]) ProgressSlot();
+            next_field += sizeof(ProgressSlot) * P;
+        }
+        if (ipc_type != "pipe" && stats) shared_stats = (WorkerStats*)next_field;
+    }
+
+    if (ipc_type == "eventfd") {
+        // Contador do kernel herdado pelos filhos; não bloqueante para o master drenar
+        event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (event_fd == -1) {
+            perror("Erro ao criar eventfd");
+            exit(1);
+        }
+    }
+
+    if (ipc_type == "pipe") {
+        // Aloca array de ponteiros para os pipes
+        ipc_pipes = new int*[P];
+        for (int i = 0; i < P; i++) {
+            ipc_pipes[i] = new int[2]; // Cada pipe tem 2 descritores: [0]=leitura, [1]=escrita
+            // Cria o pipe. Se falhar, encerra.
+            if (pipe(ipc_pipes[i]) == -1) {
+                perror("Erro ao criar pipe");
+                exit(1);
+            }
+        }
+    }
+
+    // ---------------------------------------------------------
+    // 3. Loop de Criação de Processos (Fork)
+    // ---------------------------------------------------------
+    uint64_t current_start = from; // Início do próximo subintervalo a ser atribuído
+    std::vector<WorkerStats> worker_stats(P);  // Preenchido apenas com --stats
+    std::vector<pid_t> pids(P);
+    int64_t t0_ns = now_ns();
+
+    for (int i = 0; i < P; i++) {
+        // Calcula onde começa e termina o intervalo do processo 'i'
+        // Distribui o 'remainder' dando 1 número extra para os primeiros processos
+        uint64_t chunk_size = base_chunk_size + ((uint64_t)i < extra_numbers ? 1 : 0);
+        uint64_t current_end = current_start + chunk_size - 1;
+
+        // Cria um novo processo duplicando o atual
+        worker_stats[i].fork_ns = now_ns();
+        pid_t pid = fork();
+
+        if (pid < 0) {
+            perror("Erro no fork");
+            exit(1);
+        } 
+        else if (pid == 0) {
+            // =====================================================
+            // CÓDIGO DO PROCESSO FILHO (WORKER)
+            // =====================================================
+            apply_affinity(opts, i);
+            
+            // Gerenciamento de Pipes no Filho
+            if (ipc_type == "pipe") {
+                for (int j = 0; j < P; j++) {
+                    close(ipc_pipes[j][0]); // Filho NUNCA lê do pipe, fecha leitura
+                    if (j != i) close(ipc_pipes[j][1]); // Fecha escrita dos pipes dos IRMÃOS
+                }
+            }
+
+            // Realiza o trabalho pesado (CPU-bound)
+            WorkerStats& my_stats = worker_stats[i]; // Cópia privada do filho (COW)
+            my_stats.start_ns = now_ns();
+            std::function<void(long long, uint64_t)> on_block;
+            if (notify) {
+                on_block = [&](long long primes_so_far, uint64_t tested_so_far) {
+                    progress[i].tested.store(tested_so_far, std::memory_order_relaxed);
+                    progress[i].primes.store(primes_so_far, std::memory_order_release);
+                    notify_master(control, event_fd);
+                };
+            }
+            long long primes_found = worker_count(current_start, current_end, N, P,
+                                                  opts, chunk, control, kernel, my_stats.tested,
+                                                  on_block);
+            my_stats.end_ns = now_ns();
+            my_stats.primes = primes_found;
+
+            // Envia o resultado para o Pai
+            if (ipc_type == "pipe") {
+                // Escreve o resultado binário no pipe dedicado a este processo (i)
+                if (write(ipc_pipes[i][1], &primes_found, sizeof(long long)) == -1) {
+                    perror("Erro na escrita do pipe");
+                    exit(1);
+                }
+                // Com --stats, as estatísticas seguem o resultado no mesmo pipe
+                if (stats && write(ipc_pipes[i][1], &my_stats, sizeof(WorkerStats)) == -1) {
+                    perror("Erro na escrita do pipe");
+                    exit(1);
+                }
+                close(ipc_pipes[i][1]); // Fecha a ponta de escrita após enviar (envia EOF)
+            } else if (ipc_type == "shm") {
+                // Escreve diretamente no slot do array compartilhado na memória
+                shared_results[i] = primes_found; 
+                if (stats) shared_stats[i] = my_stats;
+            } else {
+                // Totais finais já estão no placar: só falta marcar o fim e avisar
+                if (stats) shared_stats[i] = my_stats;
+                progress[i].primes.store(primes_found, std::memory_order_relaxed);
+                progress[i].done.store(1, std::memory_order_release);
+                notify_master(control, event_fd);
+            }
+            
+            // Limpeza de memória alocada no heap (herdada do pai) para evitar vazamento no valgrind
+            if (ipc_type == "pipe") {
+                for(int k=0; k<P; k++) delete[] ipc_pipes[k];
+                delete[] ipc_pipes;
+            }
+
+            exit(0); // OBRIGATÓRIO: Filho termina aqui para não continuar o loop do pai
+        }
+
+        // =====================================================
+        // CÓDIGO DO PROCESSO PAI (MASTER) CONTINUAÇÃO DO LOOP
+        // =====================================================
+        
+        // Se usar pipe, pai fecha a ponta de ESCRITA deste pipe específico.
+        // Se o pai mantiver aberto, o 'read' nunca retornará 0 (EOF) se decidirmos ler em loop.
+        if (ipc_type == "pipe") {
+            close(ipc_pipes[i][1]);
+        }
+        pids[i] = pid;
+
+        // Atualiza o início para o próximo worker
+        current_start = current_end + 1;
+    }
+
+    // ---------------------------------------------------------
+    // 4. Sincronização e Agregação de Resultados
+    // ---------------------------------------------------------
+    long long total_primes = 0;
+
+    if (notify) {
+        // Agregação em ordem de conclusão: a cada aviso, soma só o que cada
+        // worker acrescentou desde a última leitura e reaproveita (waitid) os
+        // filhos que já saíram, sem bloquear nos que ainda trabalham.
+        std::vector<long long> seen_primes(P, 0);
+        std::vector<int> completion_order;
+        uint32_t seen_wakeups = 0;
+        int64_t last_progress_ns = 0;
+        int remaining = P;
+
+        while (true) {
+            // Se todos já marcaram 'done', os que faltam estão só saindo: o
+            // waitid pode bloquear (nenhum aviso novo viria para acordar o master)
+            bool all_done = true;
+            for (int i = 0; i < P; i++) {
+                if (progress[i].done.load(std::memory_order_acquire) == 0) all_done = false;
+            }
+            while (remaining > 0) {
+                siginfo_t info;
+                struct rusage usage;
+                info.si_pid = 0;
+                // O wrapper da glibc não expõe o rusage do waitid; a syscall expõe
+                int wait_flags = WEXITED | (all_done ? 0 : WNOHANG);
+                if (syscall(SYS_waitid, P_ALL, 0, &info, wait_flags, &usage) == -1 || info.si_pid == 0) {
+                    break;
+                }
+                for (int k = 0; k < P; k++) {
+                    if (pids[k] != info.si_pid) continue;
+                    if (progress[k].done.load(std::memory_order_acquire) == 0) {
+                        std::cerr << "Erro: worker " << k << " (pid " << info.si_pid
+                                  << ") terminou sem publicar o resultado." << std::endl;
+                        exit(1);
+                    }
+                    worker_stats[k].pid = info.si_pid;
+                    worker_stats[k].exit_ns = now_ns();
+                    worker_stats[k].cpu_ns = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL +
+                                             (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+                    worker_stats[k].max_rss_kb = usage.ru_maxrss;
+                    completion_order.push_back(k);
+                }
+                remaining--;
+            }
+
+            uint64_t tested_total = 0;
+            for (int i = 0; i < P; i++) {
+                long long published = progress[i].primes.load(std::memory_order_acquire);
+                total_primes += published - seen_primes[i];
+                seen_primes[i] = published;
+                tested_total += progress[i].tested.load(std::memory_order_relaxed);
+            }
+
+            int64_t now = now_ns();
+            if (opts.progress && (remaining == 0 || now - last_progress_ns >= 500000000LL)) {
+                print_progress(tested_total, total_numbers, total_primes, now - t0_ns);
+                last_progress_ns = now;
+            }
+            if (remaining == 0) break;
+            wait_for_update(control, event_fd, seen_wakeups, 250);
+        }
+        if (opts.progress) fprintf(stderr, "\n");
+
+        int64_t finished_ns = now_ns();
+        if (stats) {
+            for (int i = 0; i < P; i++) {
+                worker_stats[i].start_ns = shared_stats[i].start_ns;
+                worker_stats[i].end_ns = shared_stats[i].end_ns;
+                worker_stats[i].tested = shared_stats[i].tested;
+                worker_stats[i].primes = shared_stats[i].primes;
+            }
+            print_worker_stats(worker_stats, t0_ns, finished_ns - t0_ns, 0);
+            fprintf(stderr, "stats: completion_order=");
+            for (size_t k = 0; k < completion_order.size(); k++) {
+                fprintf(stderr, "%s%d", k > 0 ? "," : "", completion_order[k]);
+            }
+            fprintf(stderr, "\n");
+            if (!opts.trace_path.empty()) {
+                write_chrome_trace(opts.trace_path, worker_stats, t0_ns, finished_ns, finished_ns);
+            }
+        }
+
+        if (event_fd >= 0) close(event_fd);
+        control->~SharedControl();
+        munmap(shared_region, shared_size);
+        return total_primes;
+    }
+
+    // Passo A: Esperar TODOS os filhos terminarem.
+    // Isso é crucial para evitar processos "zumbis" e garantir que todos calcularam.
+    // wait4 devolve também o rusage do filho (tempo de CPU e pico de memória).
+    int64_t wait_begin_ns = now_ns();
+    for (int i = 0; i < P; i++) {
+        struct rusage usage;
+        pid_t done = wait4(-1, NULL, 0, &usage);
+        for (int k = 0; k < P; k++) {
+            if (pids[k] == done) {
+                worker_stats[k].pid = done;
+                worker_stats[k].exit_ns = now_ns();
+                worker_stats[k].cpu_ns = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL +
+                                         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+                worker_stats[k].max_rss_kb = usage.ru_maxrss;
+            }
+        }
+    }
+    int64_t aggregate_begin_ns = now_ns();
+
+    // Passo B: Coletar e somar os resultados parciais
+    if (ipc_type == "pipe") {
+        for (int i = 0; i < P; i++) {
+            long long partial_primes = 0;
+            // Lê do pipe. O read retorna > 0 se leu bytes.
+            if (read(ipc_pipes[i][0], &partial_primes, sizeof(long long)) > 0) {
+                total_primes += partial_primes;
+            }
+            WorkerStats received;
+            if (stats && read(ipc_pipes[i][0], &received, sizeof(WorkerStats)) == (ssize_t)sizeof(WorkerStats)) {
+                worker_stats[i].start_ns = received.start_ns;
+                worker_stats[i].end_ns = received.end_ns;
+                worker_stats[i].tested = received.tested;
+                worker_stats[i].primes = received.primes;
+            }
+            close(ipc_pipes[i][0]); // Fecha a ponta de leitura
+            delete[] ipc_pipes[i];  // Libera memória do par de inteiros
+        }
+        delete[] ipc_pipes; // Libera o array de ponteiros
+    } else if (ipc_type == "shm") {
+        // No caso de memória compartilhada, os dados já estão lá
+        for (int i = 0; i < P; i++) {
+            total_primes += shared_results[i];
+            if (stats) {
+                worker_stats[i].start_ns = shared_stats[i].start_ns;
+                worker_stats[i].end_ns = shared_stats[i].end_ns;
+                worker_stats[i].tested = shared_stats[i].tested;
+                worker_stats[i].primes = shared_stats[i].primes;
+            }
+        }
+    }
+    int64_t aggregate_end_ns = now_ns();
+
+    if (stats) {
+        print_worker_stats(worker_stats, t0_ns, aggregate_begin_ns - wait_begin_ns,
+                           aggregate_end_ns - aggregate_begin_ns);
+        if (!opts.trace_path.empty()) {
+            write_chrome_trace(opts.trace_path, worker_stats, t0_ns, aggregate_begin_ns, aggregate_end_ns);
+        }
+    }
+
+    // Desfaz o mapeamento da memória (limpeza)
+    if (shared_region != nullptr) {
+        control->~SharedControl();
+        munmap(shared_region, shared_size);
+    }
+
+    return total_primes;
+}
+
+// ==========================================
+// Implementação com THREADS (Work-Stealing)
+// ==========================================
+
+/**
+ * Estrutura: WorkTask
+ * -------------------
+ * Um bloco de trabalho [start, end] a ser contado por alguma thread.
+ */
+struct WorkTask {
+    uint64_t start;
+    uint64_t end;
+};
+
+/**
+ * Estrutura: WorkDeque
+ * --------------------
+ * Fila dupla de tarefas de uma thread. A dona retira do FIM (LIFO, blocos
+ * ainda quentes na cache) e as ladras roubam do INÍCIO (FIFO), o que reduz
+ * a disputa pelas mesmas posições. Alinhada à linha de cache para que o
+ * mutex de uma thread não compartilhe linha com o da vizinha.
+ */
+struct alignas(64) WorkDeque {
+    std::mutex lock;
+    std::deque<WorkTask> tasks;
+};
+
+/**
+ * Estrutura: PaddedCounter
+ * ------------------------
+ * Contador parcial de uma thread, ocupando uma linha de cache inteira para
+ * evitar falso compartilhamento (false sharing) entre threads vizinhas.
+ */
+struct alignas(64) PaddedCounter {
+    long long value = 0;
+};
+
+/**
+ * Função: pop_or_steal
+ * --------------------
+ * Obtém a próxima tarefa da thread 'self': primeiro do fim da própria fila;
+ * se estiver vazia, tenta roubar do início das filas das outras threads,
+ * começando pela vizinha para espalhar as tentativas de roubo.
+ * Como todas as tarefas são criadas antes das threads iniciarem, uma volta
+ * completa sem sucesso significa que o trabalho acabou.
+ */
+bool pop_or_steal(std::vector<WorkDeque>& deques, int self, WorkTask& task) {
+    {
+        std::lock_guard<std::mutex> guard(deques[self].lock);
+        if (!deques[self].tasks.empty()) {
+            task = deques[self].tasks.back();
+            deques[self].tasks.pop_back();
+            return true;
+        }
+    }
+
+    int P = (int)deques.size();
+    for (int k = 1; k < P; k++) {
+        WorkDeque& victim = deques[(self + k) % P];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Função: run_threads
+ * -------------------
+ * Executa a contagem com P threads no mesmo processo (sem fork nem IPC).
+ * Passos principais:
+ * 1. Divide [from, N] em blocos de 'chunk' números.
+ * 2. Distribui os blocos em faixas contíguas nas filas das P threads.
+ * 3. Cada thread consome a própria fila e, ao esvaziá-la, rouba das demais,
+ *    compensando o custo maior dos números altos sem escalonador central.
+ * 4. Cada thread acumula no seu contador alinhado; o total é somado no join.
+ * Assim como em run_concurrent, 'kernel' é a tarefa aplicada a cada bloco e
+ * --algo lmo distribui apenas a fase de crivo do pi_lmo.
+ */
+long long run_threads(uint64_t from, uint64_t N, int P, const RunOptions& opts,
+                      const RangeKernel& kernel = RangeKernel()) {
+    if (!kernel) {
+        if (opts.algo == "lmo") {
+            return count_primes_lmo(from, N, [&](uint64_t start, uint64_t end, const RangeKernel& task) {
+                return run_threads(start, end, P, opts, task);
+            });
+        }
+        return run_threads(from, N, P, opts, default_kernel(opts));
+    }
+
+    uint64_t total_numbers = N - from + 1;
+    uint64_t chunk = resolve_chunk_size(total_numbers, P, opts.chunk, opts.blocks_per_worker);
+    uint64_t num_tasks = total_numbers / chunk + (total_numbers % chunk != 0);
+
+    std::vector<WorkDeque> deques(P);
+    for (uint64_t t = 0; t < num_tasks; t++) {
+        uint64_t start = from + t * chunk;
+        uint64_t end = std::min<uint64_t>(start + (chunk - 1), N);
+        deques[t * P / num_tasks].tasks.push_back({start, end});
+    }
+
+    std::vector<PaddedCounter> partial(P);
+    std::vector<std::thread> threads;
+    threads.reserve(P);
+
+    for (int i = 0; i < P; i++) {
+        threads.emplace_back([&deques, &partial, &kernel, &opts, i]() {
+            apply_affinity(opts, i);
+            WorkTask task;
+            long long primes_found = 0;
+            while (pop_or_steal(deques, i, task)) {
+                primes_found += kernel(task.start, task.end);
+            }
+            partial[i].value = primes_found;
+        });
+    }
+
+    long long total_primes = 0;
+    for (int i = 0; i < P; i++) {
+        threads[i].join();
+        total_primes += partial[i].value;
+    }
+    return total_primes;
+}
+
+// ==========================================
+// Utilitários de Linha de Comando
+// ==========================================
+
+// Maior N aceito: mantém o cursor compartilhado e os blocos longe do
+// transbordamento de uint64_t, e ainda cobre intervalos como [1e18, 1e18 + 1e7]
+constexpr uint64_t MAX_N = (1ULL << 63) - 1;
+
+/**
+ * Função: parse_u64
+ * -----------------
+ * Converte um texto em uint64_t. Aceita apenas dígitos decimais ou a forma
+ * abreviada "<dígitos>e<expoente>" (ex.: "5e6", "1e18"). Diferente de
+ * std::stoull, rejeita sinais, sufixos e valores que não cabem em 64 bits.
+ * Retorna false em caso de erro.
+ */
+bool parse_u64(const std::string& text, uint64_t& value) {
+    size_t e_pos = text.find_first_of("eE");
+    std::string mantissa = text.substr(0, e_pos);
+    std::string exponent = (e_pos == std::string::npos) ? "" : text.substr(e_pos + 1);
+
+    if (mantissa.empty() || mantissa.find_first_not_of("0123456789") != std::string::npos) return false;
+    if (e_pos != std::string::npos &&
+        (exponent.empty() || exponent.find_first_not_of("0123456789") != std::string::npos)) return false;
+
+    value = 0;
+    for (char c : mantissa) {
+        uint64_t digit = (uint64_t)(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    if (exponent.size() > 2) return value == 0;
+    for (int k = exponent.empty() ? 0 : std::stoi(exponent); k > 0; k--) {
+        if (value > UINT64_MAX / 10) return false;
+        value *= 10;
+    }
+    return true;
+}
+
+/**
+ * Função: split_list
+ * ------------------
+ * Divide uma lista separada por vírgulas ("1,2,4") em seus itens.
+ */
+std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t comma = text.find(',', begin);
+        if (comma == std::string::npos) comma = text.size();
+        if (comma > begin) items.push_back(text.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    return items;
+}
+
+/**
+ * Estrutura: CpuInfo
+ * ------------------
+ * Posição de uma CPU lógica na topologia (lida de /sys): soquete, núcleo
+ * físico e índice do hyperthread dentro do núcleo (0 = primeira thread).
+ */
+struct CpuInfo {
+    int cpu;
+    int package;
+    int core;
+    int thread;
+};
+
+int read_sysfs_int(const std::string& path, int fallback) {
+    std::ifstream in(path);
+    int value = fallback;
+    if (!(in >> value)) return fallback;
+    return value;
+}
+
+/**
+ * Função: parse_cpu_list
+ * ----------------------
+ * Interpreta listas no formato do kernel, como "0,2,4-7". Retorna false
+ * se algum item for inválido.
+ */
+bool parse_cpu_list(const std::string& text, std::vector<int>& cpus) {
+    for (const std::string& item : split_list(text)) {
+        size_t dash = item.find('-');
+        uint64_t first = 0, last = 0;
+        if (dash == std::string::npos) {
+            if (!parse_u64(item, first)) return false;
+            last = first;
+        } else if (!parse_u64(item.substr(0, dash), first) || !parse_u64(item.substr(dash + 1), last)) {
+            return false;
+        }
+        if (first > last || last >= CPU_SETSIZE) return false;
+        for (uint64_t c = first; c <= last; c++) cpus.push_back((int)c);
+    }
+    return !cpus.empty();
+}
+
+/**
+ * Função: plan_affinity
+ * ---------------------
+ * Define a CPU de cada worker, considerando apenas as CPUs permitidas ao
+ * processo (sched_getaffinity):
+ * - "compact": preenche um soquete antes do próximo, colocando os
+ *   hyperthreads de um mesmo núcleo lado a lado (compartilham L1/L2);
+ * - "scatter": alterna entre soquetes e ocupa todos os núcleos físicos
+ *   antes de usar o segundo hyperthread de qualquer um deles;
+ * - lista explícita ("0,2,4-7"): o worker i usa o item i (módulo o tamanho).
+ * Com mais workers que CPUs, o plano se repete em ciclo. Retorna false se
+ * a lista explícita for inválida ou citar CPUs não permitidas.
+ */
+bool plan_affinity(const std::string& pin, int P, std::vector<int>& plan) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    std::vector<int> order;
+    if (pin != "compact" && pin != "scatter") {
+        if (!parse_cpu_list(pin, order)) return false;
+        for (int cpu : order) {
+            if (!CPU_ISSET(cpu, &allowed)) return false;
+        }
+    } else {
+        std::vector<CpuInfo> cpus;
+        std::map<std::pair<int, int>, int> threads_per_core;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &allowed)) continue;
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            CpuInfo info;
+            info.cpu = cpu;
+            info.package = read_sysfs_int(base + "physical_package_id", 0);
+            info.core = read_sysfs_int(base + "core_id", cpu);
+            info.thread = threads_per_core[{info.package, info.core}]++;
+            cpus.push_back(info);
+        }
+
+        if (pin == "compact") {
+            std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& x, const CpuInfo& y) {
+                if (x.package != y.package) return x.package < y.package;
+                if (x.core != y.core) return x.core < y.core;
+                return x.thread < y.thread;
+            });
+            for (const CpuInfo& info : cpus) order.push_back(info.cpu);
+        } else {
+            // Ordena por (thread, núcleo) em cada soquete e intercala os soquetes
+            std::map<int, std::vector<CpuInfo>> by_package;
+            for (const CpuInfo& info : cpus) by_package[info.package].push_back(info);
+            for (auto& entry : by_package) {
+                std::sort(entry.second.begin(), entry.second.end(), [](const CpuInfo& x, const CpuInfo& y) {
+                    if (x.thread != y.thread) return x.thread < y.thread;
+                    return x.core < y.core;
+                });
+            }
+            for (size_t k = 0; order.size() < cpus.size(); k++) {
+                for (auto& entry : by_package) {
+                    if (k < entry.second.size()) order.push_back(entry.second[k].cpu);
+                }
+            }
+        }
+    }
+
+    plan.clear();
+    for (int i = 0; i < P; i++) plan.push_back(order[i % order.size()]);
+    return true;
+}
+
+/**
+ * Função: run_mode
+ * ----------------
+ * Executa uma configuração completa ("seq", "par" ou "par-threads") e
+ * devolve a quantidade de primos. Usada por main e pelo subcomando bench.
+ */
+long long run_mode(const std::string& mode, uint64_t from, uint64_t N, int P,
+                   const std::string& ipc, const RunOptions& opts) {
+    if (mode == "seq") {
+        apply_affinity(opts, 0);
+        return run_sequential(from, N, opts.algo);
+    } else if (mode == "par-threads") {
+        return run_threads(from, N, P, opts);
+    }
+    return run_concurrent(from, N, P, ipc, opts);
+}
+
+// ==========================================
+// Cache Persistente de π(x) (--cache)
+// ==========================================
+
+/**
+ * Formato do arquivo de cache (binário, host-endian, mapeável com mmap):
+ *
+ *   [PiCacheHeader: 64 bytes][uint64_t pi[0]][uint64_t pi[1]]...
+ *
+ * pi[k] = π((k + 1) · 2^step_log2), ou seja, a quantidade de primos até o
+ * (k+1)-ésimo checkpoint. Apenas as 'count' primeiras entradas são válidas.
+ *
+ * Escrita: novos checkpoints são calculados fora de qualquer lock e depois
+ * anexados sob flock(LOCK_EX). O valor é gravado antes de 'count' ser
+ * publicado com memory_order_release, então um leitor que lê 'count' com
+ * acquire nunca enxerga uma entrada incompleta, mesmo sem pegar o lock.
+ */
+constexpr char PI_CACHE_MAGIC[8] = {'P', 'R', 'I', 'M', 'E', 'C', 'N', 'T'};
+constexpr uint32_t PI_CACHE_VERSION = 1;
+constexpr uint32_t PI_CACHE_STEP_LOG2 = 24;
+constexpr uint64_t PI_CACHE_STEP = 1ULL << PI_CACHE_STEP_LOG2;
+
+struct PiCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t step_log2;
+    std::atomic<uint64_t> count; // Checkpoints válidos
+    uint64_t reserved[5];
+};
+
+static_assert(sizeof(PiCacheHeader) == 64, "cabeçalho do cache deve ter 64 bytes");
+
+/**
+ * Estrutura: PiCache
+ * ------------------
+ * Arquivo de cache aberto e mapeado. 'capacity' é a quantidade de entradas
+ * cobertas pelo mapeamento atual; o arquivo pode ter crescido desde então
+ * (outro processo), e nesse caso pi_cache_remap atualiza a visão.
+ */
+struct PiCache {
+    int fd = -1;
+    void* map = MAP_FAILED;
+    size_t map_size = 0;
+    PiCacheHeader* header = nullptr;
+    const uint64_t* entries = nullptr;
+    uint64_t capacity = 0;
+};
+
+/**
+ * Função: pi_cache_remap
+ * ----------------------
+ * (Re)mapeia o arquivo inteiro com o tamanho atual em disco.
+ */
+void pi_cache_remap(PiCache& cache) {
+    struct stat st;
+    if (fstat(cache.fd, &st) == -1) {
+        perror("Erro no fstat do cache");
+        exit(1);
+    }
+    if (cache.map != MAP_FAILED) munmap(cache.map, cache.map_size);
+
+    cache.map_size = (size_t)st.st_size;
+    cache.map = mmap(NULL, cache.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, cache.fd, 0);
+    if (cache.map == MAP_FAILED) {
+        perror("Erro no mmap do cache");
+        exit(1);
+    }
+    cache.header = (PiCacheHeader*)cache.map;
+    cache.entries = (const uint64_t*)((char*)cache.map + sizeof(PiCacheHeader));
+    cache.capacity = (cache.map_size - sizeof(PiCacheHeader)) / sizeof(uint64_t);
+}
+
+/**
+ * Função: pi_cache_valid_count
+ * ----------------------------
+ * Quantidade de checkpoints válidos e visíveis no mapeamento atual.
+ */
+uint64_t pi_cache_valid_count(const PiCache& cache) {
+    return std::min(cache.header->count.load(std::memory_order_acquire), cache.capacity);
+}
+
+/**
+ * Função: pi_cache_open
+ * ---------------------
+ * Abre (ou cria) o arquivo de cache. Um arquivo vazio é inicializado sob
+ * lock exclusivo; um arquivo existente tem magic, versão e passo validados.
+ */
+PiCache pi_cache_open(const std::string& path) {
+    PiCache cache;
+    cache.fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (cache.fd == -1) {
+        perror("Erro ao abrir arquivo de cache");
+        exit(1);
+    }
+
+    flock(cache.fd, LOCK_EX);
+    struct stat st;
+    if (fstat(cache.fd, &st) == -1) {
+        perror("Erro no fstat do cache");
+        exit(1);
+    }
+    if (st.st_size == 0) {
+        PiCacheHeader header;
+        memcpy(header.magic, PI_CACHE_MAGIC, sizeof(header.magic));
+        header.version = PI_CACHE_VERSION;
+        header.step_log2 = PI_CACHE_STEP_LOG2;
+        header.count.store(0, std::memory_order_relaxed);
+        memset(header.reserved, 0, sizeof(header.reserved));
+        if (pwrite(cache.fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            perror("Erro ao inicializar arquivo de cache");
+            exit(1);
+        }
+    } else if ((size_t)st.st_size < sizeof(PiCacheHeader)) {
+        std::cerr << "Erro: arquivo de cache '" << path << "' está truncado." << std::endl;
+        exit(1);
+    }
+    pi_cache_remap(cache);
+    flock(cache.fd, LOCK_UN);
+
+    if (memcmp(cache.header->magic, PI_CACHE_MAGIC, sizeof(PI_CACHE_MAGIC)) != 0 ||
+        cache.header->version != PI_CACHE_VERSION ||
+        cache.header->step_log2 != PI_CACHE_STEP_LOG2) {
+        std::cerr << "Erro: '" << path << "' não é um cache de primecount compatível "
+                  << "(versão " << PI_CACHE_VERSION << ", passo 2^" << PI_CACHE_STEP_LOG2 << ")." << std::endl;
+        exit(1);
+    }
+    return cache;
+}
+
+void pi_cache_close(PiCache& cache) {
+    if (cache.map != MAP_FAILED) munmap(cache.map, cache.map_size);
+    close(cache.fd);
+}
+
+/**
+ * Função: pi_cache_append
+ * -----------------------
+ * Anexa o checkpoint de índice 'index' (já calculado) sob lock exclusivo.
+ * Se outro processo já publicou esse índice, nada é escrito. Devolve true
+ * se a entrada foi gravada por este processo.
+ */
+bool pi_cache_append(PiCache& cache, uint64_t index, uint64_t value) {
+    flock(cache.fd, LOCK_EX);
+    uint64_t count = cache.header->count.load(std::memory_order_acquire);
+    bool written = false;
+    if (count == index) {
+        off_t offset = (off_t)(sizeof(PiCacheHeader) + index * sizeof(uint64_t));
+        if (pwrite(cache.fd, &value, sizeof(value), offset) != (ssize_t)sizeof(value)) {
+            perror("Erro ao gravar checkpoint no cache");
+            exit(1);
+        }
+        cache.header->count.store(index + 1, std::memory_order_release);
+        written = true;
+    }
+    flock(cache.fd, LOCK_UN);
+    if (pi_cache_valid_count(cache) <= index) pi_cache_remap(cache);
+    return written;
+}
+
+// Trechos de 2^24 por worker em cada lote de checkpoints
+constexpr uint64_t PI_CACHE_BLOCKS_PER_WORKER = 8;
+
+/**
+ * Função: count_cache_blocks
+ * --------------------------
+ * Conta os primos de 'n' trechos consecutivos de 2^24 números, a partir do
+ * trecho 'first', e devolve a contagem de cada um. No modo "seq" roda no
+ * próprio processo; em "par" e "par-threads" os P workers (processos ou
+ * threads, conforme o modo) são criados uma única vez para o lote inteiro
+ * e dividem os trechos de forma cíclica.
+ */
+std::vector<long long> count_cache_blocks(uint64_t first, uint64_t n, const std::string& mode,
+                                          int P, const RunOptions& opts) {
+    std::vector<long long> counts(n, 0);
+    auto count_block = [&](uint64_t i) {
+        uint64_t block = first + i;
+        uint64_t start = std::max<uint64_t>(block * PI_CACHE_STEP + 1, 2);
+        return count_primes_interval(start, (block + 1) * PI_CACHE_STEP, opts.algo);
+    };
+
+    int workers = (int)std::min<uint64_t>((uint64_t)P, n);
+    if (mode == "seq" || workers <= 1) {
+        apply_affinity(opts, 0);
+        for (uint64_t i = 0; i < n; i++) counts[i] = count_block(i);
+        return counts;
+    }
+
+    if (mode == "par-threads") {
+        std::vector<std::thread> threads;
+        for (int w = 0; w < workers; w++) {
+            threads.emplace_back([&, w]() {
+                apply_affinity(opts, w);
+                for (uint64_t i = w; i < n; i += workers) counts[i] = count_block(i);
+            });
+        }
+        for (auto& t : threads) t.join();
+        return counts;
+    }
+
+    // "par": processos filhos escrevem as contagens num vetor compartilhado
+    size_t bytes = n * sizeof(long long);
+    long long* shared = (long long*)mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("Erro no mmap do lote de checkpoints");
+        exit(1);
+    }
+    std::vector<pid_t> pids;
+    for (int w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("Erro no fork");
+            exit(1);
+        } else if (pid == 0) {
+            apply_affinity(opts, w);
+            for (uint64_t i = w; i < n; i += workers) shared[i] = count_block(i);
+            _exit(0);
+        }
+        pids.push_back(pid);
+    }
+    bool failed = false;
+    for (pid_t pid : pids) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed = true;
+        }
+    }
+    if (failed) {
+        std::cerr << "Erro: um worker do cache terminou de forma anormal." << std::endl;
+        exit(1);
+    }
+    std::copy(shared, shared + n, counts.begin());
+    munmap(shared, bytes);
+    return counts;
+}
+
+/**
+ * Função: cached_pi
+ * -----------------
+ * Calcula π(x) partindo do maior checkpoint <= x. Checkpoints que faltam
+ * até x são calculados em lotes (P · PI_CACHE_BLOCKS_PER_WORKER trechos de
+ * 2^24 números, um único conjunto de workers por lote) e publicados no
+ * arquivo ao fim de cada lote, de modo que uma execução interrompida ainda
+ * deixa o trabalho feito salvo. Se outro processo publicou antes um dos
+ * índices, o lote para ali e os checkpoints dele são aproveitados.
+ */
+long long cached_pi(PiCache& cache, uint64_t x, const std::string& mode, int P,
+                    const std::string& ipc, const RunOptions& opts, uint64_t& new_checkpoints) {
+    if (x < 2) return 0;
+
+    uint64_t target = x / PI_CACHE_STEP; // Checkpoints completos abaixo de x
+    uint64_t count = pi_cache_valid_count(cache);
+    if (count < target && cache.header->count.load(std::memory_order_acquire) > count) {
+        pi_cache_remap(cache);
+        count = pi_cache_valid_count(cache);
+    }
+
+    while (count < target) {
+        uint64_t batch = std::min<uint64_t>(target - count,
+                                            (uint64_t)std::max(P, 1) * PI_CACHE_BLOCKS_PER_WORKER);
+        std::vector<long long> counts = count_cache_blocks(count, batch, mode, P, opts);
+        uint64_t value = count == 0 ? 0 : cache.entries[count - 1];
+        for (uint64_t i = 0; i < batch; i++) {
+            value += (uint64_t)counts[i];
+            if (!pi_cache_append(cache, count + i, value)) break;
+            new_checkpoints++;
+        }
+        count = pi_cache_valid_count(cache);
+    }
+
+    uint64_t k = std::min(target, count);
+    long long result = k == 0 ? 0 : (long long)cache.entries[k - 1];
+    uint64_t rest_start = std::max<uint64_t>(k * PI_CACHE_STEP + 1, 2);
+    if (rest_start <= x) {
+        result += run_mode(mode, rest_start, x, P, ipc, opts);
+    }
+    return result;
+}
+
+/**
+ * Função: run_mode_cached
+ * -----------------------
+ * Conta os primos em [from, N] como π(N) - π(from - 1), ambos resolvidos
+ * pelo cache. Informa em stderr quantos checkpoints foram reaproveitados
+ * e quantos foram acrescentados.
+ */
+long long run_mode_cached(const std::string& cache_path, const std::string& mode,
+                          uint64_t from, uint64_t N, int P,
+                          const std::string& ipc, const RunOptions& opts) {
+    // π(x) do LMO já é sublinear: checkpoints custariam mais do que poupam
+    if (opts.algo == "lmo") {
+        std::cerr << "cache: ignorado com --algo lmo" << std::endl;
+        return run_mode(mode, from, N, P, ipc, opts);
+    }
+    PiCache cache = pi_cache_open(cache_path);
+    uint64_t count_before = pi_cache_valid_count(cache);
+    uint64_t new_checkpoints = 0;
+
+    long long primes = cached_pi(cache, N, mode, P, ipc, opts, new_checkpoints);
+    if (from > 2) {
+        primes -= cached_pi(cache, from - 1, mode, P, ipc, opts, new_checkpoints);
+    }
+
+    std::cerr << "cache: step=2^" << PI_CACHE_STEP_LOG2
+              << " checkpoints=" << pi_cache_valid_count(cache)
+              << " reused=" << std::min(count_before, N / PI_CACHE_STEP)
+              << " added=" << new_checkpoints << std::endl;
+    pi_cache_close(cache);
+    return primes;
+}
+
+// ==========================================
+// Enumeração de Primos (--emit)
+// ==========================================
+
+/**
+ * Com --emit, os workers não devolvem só a contagem: cada um escreve os
+ * primos da sua fatia, codificados como diferenças (delta) de 32 bits em
+ * relação ao primo anterior, num anel SPSC próprio em memória compartilhada.
+ * O master drena os anéis na ordem das fatias (0, 1, ..., P-1),
+ * reconstrói os primos somando as diferenças e os grava em blocos grandes
+ * no arquivo de saída. Assim não há um write() por número nem cópia por
+ * pipe: o único custo por primo são 4 bytes na memória compartilhada.
+ * Enquanto o master drena a fatia i, as fatias seguintes já vão enchendo
+ * os seus anéis. Quando um anel enche, o worker espera, o que limita a
+ * memória usada.
+ *
+ * O maior intervalo entre primos consecutivos abaixo de 2^64 é 1550, então
+ * a diferença cabe com folga em 32 bits.
+ */
+constexpr uint64_t EMIT_RING_ENTRIES = 1 << 20;       // Deltas por anel (4 MiB)
+constexpr uint64_t EMIT_BATCH = 4096;                 // Deltas acumulados antes de publicar
+constexpr std::size_t EMIT_OUTPUT_BYTES = 1 << 20;    // Buffer de escrita do master
+
+struct EmitRing {
+    alignas(64) std::atomic<uint64_t> head;   // Escrito pelo worker (produtor)
+    alignas(64) std::atomic<uint64_t> tail;   // Escrito pelo master (consumidor)
+    alignas(64) std::atomic<bool> done;       // Worker terminou a fatia
+    uint32_t deltas[EMIT_RING_ENTRIES];
+};
+
+/**
+ * Função: emit_wait
+ * -----------------
+ * Espera curta de quem encontrou o anel cheio (worker) ou vazio (master):
+ * cede a CPU algumas vezes e depois dorme 50 µs, para não competir com os
+ * processos que estão trabalhando quando P é maior que o número de núcleos.
+ */
+void emit_wait(int& spins) {
+    if (++spins < 64) {
+        sched_yield();
+    } else {
+        usleep(50);
+    }
+}
+
+/**
+ * Função: for_each_prime_interval
+ * -------------------------------
+ * Enumera em ordem crescente os primos de [start, end] com o motor
+ * escolhido. O 'lmo' e o 'simd' só contam e não enumeram, então não são
+ * aceitos aqui.
+ */
+template <typename PrimeFn>
+void for_each_prime_interval(uint64_t start, uint64_t end, const std::string& algo, PrimeFn on_prime) {
+    if (algo == "sieve") {
+        for_each_prime_sieve(start, end, on_prime);
+        return;
+    }
+    for (uint64_t n = std::max<uint64_t>(start, 2); n <= end; n++) {
+        if (algo == "mr" ? is_prime_mr(n) : is_prime_basic(n)) on_prime(n);
+    }
+}
+
+/**
+ * Estrutura: PrimeWriter
+ * ----------------------
+ * Saída bufferizada do --emit: formata os primos em texto (um por linha)
+ * ou em binário (uint64_t little-endian) num buffer de 1 MiB e só chama
+ * write() quando ele enche.
+ */
+struct PrimeWriter {
+    int fd;
+    bool binary;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+
+    PrimeWriter(int out_fd, bool binary_format)
+        : fd(out_fd), binary(binary_format), buffer(EMIT_OUTPUT_BYTES) {}
+
+    void put(uint64_t prime) {
+        if (used + 24 > buffer.size()) flush();
+        if (binary) {
+            memcpy(buffer.data() + used, &prime, sizeof(prime));
+            used += sizeof(prime);
+            return;
+        }
+        char digits[20];
+        int len = 0;
+        do {
+            digits[len++] = (char)('0' + prime % 10);
+            prime /= 10;
+        } while (prime != 0);
+        while (len > 0) buffer[used++] = digits[--len];
+        buffer[used++] = '\n';
+    }
+
+    void flush() {
+        std::size_t offset = 0;
+        while (offset < used) {
+            ssize_t written = write(fd, buffer.data() + offset, used - offset);
+            if (written == -1) {
+                if (errno == EINTR) continue;
+                perror("Erro ao gravar primos");
+                exit(1);
+            }
+            offset += (std::size_t)written;
+        }
+        used = 0;
+    }
+};
+
+/**
+ * Função: emit_worker
+ * -------------------
+ * Enumera a fatia [start, end] e publica as diferenças no anel em lotes de
+ * EMIT_BATCH, com uma única atualização de 'head' por lote.
+ */
+void emit_worker(EmitRing* ring, uint64_t start, uint64_t end, const std::string& algo) {
+    std::vector<uint32_t> batch(EMIT_BATCH);
+    std::size_t pending = 0;
+    uint64_t previous = start - 1;
+    uint64_t head = 0;
+
+    auto publish = [&]() {
+        std::size_t sent = 0;
+        int spins = 0;
+        while (sent < pending) {
+            uint64_t free_slots = EMIT_RING_ENTRIES - (head - ring->tail.load(std::memory_order_acquire));
+            if (free_slots == 0) {
+                emit_wait(spins);
+                continue;
+            }
+            uint64_t n = std::min<uint64_t>(free_slots, pending - sent);
+            for (uint64_t k = 0; k < n; k++) {
+                ring->deltas[(head + k) % EMIT_RING_ENTRIES] = batch[sent + k];
+            }
+            head += n;
+            sent += n;
+            ring->head.store(head, std::memory_order_release);
+        }
+        pending = 0;
+    };
+
+    for_each_prime_interval(start, end, algo, [&](uint64_t prime) {
+        batch[pending++] = (uint32_t)(prime - previous);
+        previous = prime;
+        if (pending == EMIT_BATCH) publish();
+    });
+    publish();
+    ring->done.store(true, std::memory_order_release);
+}
+
+/**
+ * Função: run_emit
+ * ----------------
+ * Conta e grava em 'path' os primos de [from, N]. No modo "seq" a
+ * enumeração é feita no próprio processo; no modo "par" o intervalo é
+ * dividido em P fatias contíguas (escalonamento estático, para que a ordem
+ * das fatias seja a ordem da saída) e cada worker alimenta o seu anel.
+ * Devolve a quantidade de primos gravados.
+ */
+long long run_emit(const std::string& mode, uint64_t from, uint64_t N, int P,
+                   const RunOptions& opts, const std::string& path, bool binary) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror("Erro ao criar arquivo de saída");
+        exit(1);
+    }
+    PrimeWriter writer(fd, binary);
+    long long total_primes = 0;
+
+    if (mode == "seq") {
+        apply_affinity(opts, 0);
+        for_each_prime_interval(from, N, opts.algo, [&](uint64_t prime) {
+            writer.put(prime);
+            total_primes++;
+        });
+        writer.flush();
+        close(fd);
+        return total_primes;
+    }
+
+    size_t region_size = sizeof(EmitRing) * P;
+    void* region = map_pages(region_size, true);
+    if (region == MAP_FAILED) {
+        perror("Erro no mmap");
+        exit(1);
+    }
+    EmitRing* rings = (EmitRing*)region;
+    for (int i = 0; i < P; i++) {
+        new (&rings[i].head) std::atomic<uint64_t>(0);
+        new (&rings[i].tail) std::atomic<uint64_t>(0);
+        new (&rings[i].done) std::atomic<bool>(false);
+    }
+
+    // Mesma divisão estática de run_concurrent
+    uint64_t total_numbers = N - from + 1;
+    uint64_t base_chunk_size = total_numbers / P;
+    uint64_t extra_numbers = total_numbers % P;
+    std::vector<uint64_t> slice_start(P);
+    std::vector<pid_t> pids(P, 0); // 0 = sem worker ou já recolhido
+    uint64_t current_start = from;
+    for (int i = 0; i < P; i++) {
+        uint64_t chunk_size = base_chunk_size + ((uint64_t)i < extra_numbers ? 1 : 0);
+        slice_start[i] = current_start;
+        if (chunk_size > 0) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("Erro no fork");
+                exit(1);
+            }
+            if (pid == 0) {
+                apply_affinity(opts, i);
+                emit_worker(&rings[i], current_start, current_start + chunk_size - 1, opts.algo);
+                exit(0);
+            }
+            pids[i] = pid;
+        } else {
+            rings[i].done.store(true);
+        }
+        current_start += chunk_size;
+    }
+
+    // Um worker morto deixaria o master esperando para sempre pelo seu anel
+    // (e os demais presos em anéis cheios): encerra todos e aborta
+    auto abort_emit = [&](int slice) {
+        for (pid_t pid : pids) {
+            if (pid > 0) kill(pid, SIGKILL);
+        }
+        for (pid_t pid : pids) {
+            if (pid > 0) waitpid(pid, NULL, 0);
+        }
+        std::cerr << "Erro: o worker da fatia " << slice << " terminou de forma anormal." << std::endl;
+        exit(1);
+    };
+
+    // Drena os anéis na ordem das fatias
+    for (int i = 0; i < P; i++) {
+        EmitRing& ring = rings[i];
+        uint64_t tail = 0;
+        uint64_t prime = slice_start[i] - 1;
+        int spins = 0;
+        while (true) {
+            bool finished = ring.done.load(std::memory_order_acquire);
+            uint64_t head = ring.head.load(std::memory_order_acquire);
+            if (head == tail) {
+                if (finished) break;
+                int status = 0;
+                if (pids[i] > 0 && waitpid(pids[i], &status, WNOHANG) == pids[i]) {
+                    pids[i] = 0;
+                    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+                        !ring.done.load(std::memory_order_acquire)) {
+                        abort_emit(i);
+                    }
+                    continue; // Saiu depois de marcar 'done': drena o que sobrou
+                }
+                emit_wait(spins);
+                continue;
+            }
+            spins = 0;
+            for (; tail < head; tail++) {
+                prime += ring.deltas[tail % EMIT_RING_ENTRIES];
+                writer.put(prime);
+            }
+            ring.tail.store(tail, std::memory_order_release);
+        }
+        total_primes += (long long)tail; // Cada delta é um primo
+    }
+    writer.flush();
+    close(fd);
+
+    for (int i = 0; i < P; i++) {
+        int status = 0;
+        if (pids[i] > 0 && (waitpid(pids[i], &status, 0) == -1 || !WIFEXITED(status) ||
+                            WEXITSTATUS(status) != 0)) {
+            pids[i] = 0;
+            abort_emit(i);
+        }
+        pids[i] = 0;
+    }
+    munmap(region, region_size);
+    return total_primes;
+}
+
+// ==========================================
+// PARTE F: Benchmark (subcomando bench)
+// ==========================================
+
+/**
+ * Estrutura: BenchSample
+ * ----------------------
+ * Resultado de uma execução medida: tempo de parede, primos encontrados e
+ * pico de memória residente (RSS) do processo de medição e de seus workers.
+ */
+struct BenchSample {
+    double elapsed_ms;
+    long long primes;
+    long max_rss_kb;
+};
+
+/**
+ * Função: measure_once
+ * --------------------
+ * Executa uma configuração em um processo filho dedicado e coleta a medição
+ * por um pipe. O processo separado garante que o pico de RSS (getrusage)
+ * seja só desta configuração, e não o acumulado das anteriores: o filho
+ * reporta o maior valor entre ele mesmo (RUSAGE_SELF) e os workers que
+ * criou e esperou (RUSAGE_CHILDREN).
+ */
+BenchSample measure_once(const std::string& mode, uint64_t N, int P,
+                         const std::string& ipc, const RunOptions& opts, uint64_t from = 2) {
+    int fd[2];
+    if (pipe(fd) == -1) {
+        perror("Erro ao criar pipe");
+        exit(1);
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Erro no fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        auto start_time = std::chrono::steady_clock::now();
+        long long primes = run_mode(mode, from, N, P, ipc, opts);
+        auto end_time = std::chrono::steady_clock::now();
+
+        struct rusage self_usage, children_usage;
+        getrusage(RUSAGE_SELF, &self_usage);
+        getrusage(RUSAGE_CHILDREN, &children_usage);
+
+        BenchSample sample;
+        sample.elapsed_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+        sample.primes = primes;
+        sample.max_rss_kb = std::max(self_usage.ru_maxrss, children_usage.ru_maxrss);
+        if (write(fd[1], &sample, sizeof(sample)) != (ssize_t)sizeof(sample)) _exit(1);
+        close(fd[1]);
+        _exit(0);
+    }
+
+    close(fd[1]);
+    BenchSample sample{};
+    ssize_t got = read(fd[0], &sample, sizeof(sample));
+    close(fd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (got != (ssize_t)sizeof(sample) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Erro: execução de benchmark falhou (mode=" << mode << " N=" << N << ")" << std::endl;
+        exit(1);
+    }
+    return sample;
+}
+
+/**
+ * Estrutura: BenchResult
+ * ----------------------
+ * Uma linha do relatório: configuração, estatísticas de tempo das R
+ * repetições e comparação com a linha de base sequencial.
+ */
+struct BenchResult {
+    std::string mode;
+    uint64_t N;
+    int P;
+    std::string ipc;   // "pipe", "shm", "threads" ou "-" (seq)
+    std::string algo;
+    int reps;
+    double min_ms;
+    double median_ms;
+    double p95_ms;
+    double speedup;    // T_seq(min) / T(min)
+    double efficiency; // speedup / P
+    long max_rss_kb;
+    long long primes;
+};
+
+/**
+ * Função: percentile
+ * ------------------
+ * Percentil pelo método do posto mais próximo, sobre amostras já ordenadas.
+ */
+double percentile(const std::vector<double>& sorted, double pct) {
+    size_t rank = (size_t)std::ceil(pct / 100.0 * sorted.size());
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+/**
+ * Função: bench_config
+ * --------------------
+ * Mede uma configuração: W execuções de aquecimento descartadas seguidas de
+ * R execuções medidas. Aborta se as repetições discordarem na contagem.
+ */
+BenchResult bench_config(const std::string& mode, uint64_t N, int P, const std::string& ipc,
+                         const RunOptions& opts, int warmup, int reps) {
+    std::string run_mode_name = (ipc == "threads") ? "par-threads" : mode;
+    for (int w = 0; w < warmup; w++) measure_once(run_mode_name, N, P, ipc, opts);
+
+    std::vector<double> times;
+    BenchResult result{mode, N, P, ipc, opts.algo, reps, 0, 0, 0, 1.0, 1.0, 0, -1};
+    for (int r = 0; r < reps; r++) {
+        BenchSample sample = measure_once(run_mode_name, N, P, ipc, opts);
+        if (result.primes >= 0 && result.primes != sample.primes) {
+            std::cerr << "Erro: contagens divergentes entre repetições (N=" << N << ")" << std::endl;
+            exit(1);
+        }
+        result.primes = sample.primes;
+        result.max_rss_kb = std::max(result.max_rss_kb, sample.max_rss_kb);
+        times.push_back(sample.elapsed_ms);
+    }
+
+    std::sort(times.begin(), times.end());
+    result.min_ms = times.front();
+    result.median_ms = percentile(times, 50);
+    result.p95_ms = percentile(times, 95);
+    return result;
+}
+
+/**
+ * Função: bench_key
+ * -----------------
+ * Identificador de uma configuração, usado para casar linhas com a baseline.
+ */
+std::string bench_key(const std::string& mode, const std::string& N, const std::string& P,
+                      const std::string& ipc, const std::string& algo) {
+    return mode + "|" + N + "|" + P + "|" + ipc + "|" + algo;
+}
+
+/**
+ * Função: print_bench_report
+ * --------------------------
+ * Emite o relatório em CSV (uma linha por configuração, com cabeçalho) ou
+ * JSON (um array de objetos com os mesmos campos).
+ */
+void print_bench_report(std::ostream& out, const std::vector<BenchResult>& results,
+                        const std::string& format) {
+    char line[512];
+    if (format == "csv") {
+        out << "mode,N,P,ipc,algo,reps,min_ms,median_ms,p95_ms,speedup,efficiency,max_rss_kb,primes\n";
+        for (const BenchResult& r : results) {
+            snprintf(line, sizeof(line), "%s,%llu,%d,%s,%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%ld,%lld\n",
+                     r.mode.c_str(), (unsigned long long)r.N, r.P, r.ipc.c_str(), r.algo.c_str(),
+                     r.reps, r.min_ms, r.median_ms, r.p95_ms, r.speedup, r.efficiency,
+                     r.max_rss_kb, r.primes);
+            out << line;
+        }
+        return;
+    }
+
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        snprintf(line, sizeof(line),
+                 "  {\"mode\": \"%s\", \"N\": %llu, \"P\": %d, \"ipc\": \"%s\", \"algo\": \"%s\", "
+                 "\"reps\": %d, \"min_ms\": %.3f, \"median_ms\": %.3f, \"p95_ms\": %.3f, "
+                 "\"speedup\": %.3f, \"efficiency\": %.3f, \"max_rss_kb\": %ld, \"primes\": %lld}%s\n",
+                 r.mode.c_str(), (unsigned long long)r.N, r.P, r.ipc.c_str(), r.algo.c_str(),
+                 r.reps, r.min_ms, r.median_ms, r.p95_ms, r.speedup, r.efficiency,
+                 r.max_rss_kb, r.primes, (i + 1 < results.size()) ? "," : "");
+        out << line;
+    }
+    out << "]\n";
+}
+
+/**
+ * Função: check_regressions
+ * -------------------------
+ * Compara o min_ms de cada configuração com um relatório CSV anterior
+ * (gerado pelo próprio bench). Configurações mais lentas que a baseline por
+ * mais de 'tolerance_pct' por cento são reportadas em stderr.
+ * Retorna a quantidade de regressões encontradas.
+ */
+int check_regressions(const std::string& baseline_path, const std::vector<BenchResult>& results,
+                      double tolerance_pct) {
+    std::ifstream in(baseline_path);
+    if (!in) {
+        std::cerr << "Erro: não foi possível abrir a baseline '" << baseline_path << "'." << std::endl;
+        exit(1);
+    }
+
+    std::map<std::string, double> baseline_min;
+    std::string row;
+    std::getline(in, row); // cabeçalho
+    while (std::getline(in, row)) {
+        std::vector<std::string> col = split_list(row);
+        if (col.size() < 7) continue;
+        baseline_min[bench_key(col[0], col[1], col[2], col[3], col[4])] = std::stod(col[6]);
+    }
+
+    int regressions = 0;
+    for (const BenchResult& r : results) {
+        auto it = baseline_min.find(bench_key(r.mode, std::to_string(r.N), std::to_string(r.P), r.ipc, r.algo));
+        if (it == baseline_min.end()) continue;
+        double limit = it->second * (1.0 + tolerance_pct / 100.0);
+        if (r.min_ms > limit) {
+            std::cerr << "REGRESSAO: mode=" << r.mode << " N=" << r.N << " P=" << r.P
+                      << " ipc=" << r.ipc << " algo=" << r.algo << " min_ms=" << r.min_ms
+                      << " baseline_ms=" << it->second << std::endl;
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+/**
+ * Função: run_bench_command
+ * -------------------------
+ * Subcomando 'bench': varre a matriz N x algo x P x IPC, medindo primeiro a
+ * linha de base sequencial de cada (N, algo) e depois cada configuração
+ * paralela, com W aquecimentos e R repetições por ponto. O IPC "threads"
+ * mede o modo par-threads. Retorna 2 se a verificação contra --baseline
+ * encontrar regressões (uso como gate em CI).
+ */
+int run_bench_command(int argc, char* argv[]) {
+    std::vector<std::string> n_list = {"5000000"};
+    std::vector<std::string> p_list = {"1", "2", "4"};
+    std::vector<std::string> ipc_list = {"pipe", "shm", "threads"};
+    std::vector<std::string> algo_list = {"basic", "sieve"};
+    int warmup = 1, reps = 3;
+    std::string format = "csv", out_path, baseline_path;
+    double tolerance_pct = 10.0;
+    RunOptions base_opts;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Erro: opção '" << arg << "' requer um valor." << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--N") n_list = split_list(value);
+        else if (arg == "--P") p_list = split_list(value);
+        else if (arg == "--ipc") ipc_list = split_list(value);
+        else if (arg == "--algo") algo_list = split_list(value);
+        else if (arg == "--sched") base_opts.sched = value;
+        else if (arg == "--chunk") {
+            if (!parse_u64(value, base_opts.chunk) || base_opts.chunk < 1) {
+                std::cerr << "Erro: chunk deve ser inteiro >= 1." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--warmup") warmup = std::atoi(value.c_str());
+        else if (arg == "--reps") reps = std::atoi(value.c_str());
+        else if (arg == "--format") format = value;
+        else if (arg == "--out") out_path = value;
+        else if (arg == "--baseline") baseline_path = value;
+        else if (arg == "--tolerance") tolerance_pct = std::atof(value.c_str());
+        else {
+            std::cerr << "Erro: opção desconhecida '" << arg << "'." << std::endl;
+            return 1;
+        }
+    }
+
+    if (format != "csv" && format != "json") {
+        std::cerr << "Erro: format deve ser 'csv' ou 'json'." << std::endl;
+        return 1;
+    }
+    if (reps < 1 || warmup < 0) {
+        std::cerr << "Erro: reps deve ser >= 1 e warmup >= 0." << std::endl;
+        return 1;
+    }
+    if (!is_valid_sched(base_opts.sched)) {
+        std::cerr << "Erro: sched deve ser 'static', 'dynamic' ou 'guided'." << std::endl;
+        return 1;
+    }
+    std::vector<int> p_values;
+    for (const std::string& p_text : p_list) {
+        uint64_t P = 0;
+        if (!parse_u64(p_text, P) || P < 1 || P > INT_MAX) {
+            std::cerr << "Erro: P inválido '" << p_text << "'." << std::endl;
+            return 1;
+        }
+        p_values.push_back((int)P);
+    }
+    for (const std::string& ipc : ipc_list) {
+        if (ipc != "pipe" && ipc != "shm" && ipc != "futex" && ipc != "eventfd" && ipc != "threads") {
+            std::cerr << "Erro: IPC deve ser 'pipe', 'shm', 'futex', 'eventfd' ou 'threads'." << std::endl;
+            return 1;
+        }
+    }
+    for (const std::string& algo : algo_list) {
+        if (!is_valid_algo(algo)) {
+            std::cerr << "Erro: algo deve ser 'basic', 'sieve', 'mr', 'lmo' ou 'simd'." << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    for (const std::string& n_text : n_list) {
+        uint64_t N = 0;
+        if (!parse_u64(n_text, N) || N < 2 || N > MAX_N) {
+            std::cerr << "Erro: N inválido '" << n_text << "'." << std::endl;
+            return 1;
+        }
+        for (const std::string& algo : algo_list) {
+            RunOptions opts = base_opts;
+            opts.algo = algo;
+
+            BenchResult baseline = bench_config("seq", N, 1, "-", opts, warmup, reps);
+            results.push_back(baseline);
+            std::cerr << "bench: seq N=" << N << " algo=" << algo << " min_ms=" << baseline.min_ms << std::endl;
+
+            for (int P : p_values) {
+                for (const std::string& ipc : ipc_list) {
+                    std::string mode = (ipc == "threads") ? "par-threads" : "par";
+                    BenchResult r = bench_config(mode, N, P, ipc, opts, warmup, reps);
+                    if (r.primes != baseline.primes) {
+                        std::cerr << "Erro: contagem paralela diverge da sequencial (N=" << N
+                                  << " P=" << P << " ipc=" << ipc << ")" << std::endl;
+                        return 1;
+                    }
+                    r.speedup = baseline.min_ms / r.min_ms;
+                    r.efficiency = r.speedup / P;
+                    results.push_back(r);
+                    std::cerr << "bench: " << mode << " N=" << N << " P=" << P << " ipc=" << ipc
+                              << " algo=" << algo << " min_ms=" << r.min_ms << std::endl;
+                }
+            }
+        }
+    }
+
+    if (out_path.empty()) {
+        print_bench_report(std::cout, results, format);
+    } else {
+        std::ofstream out(out_path);
+        if (!out) {
+            std::cerr << "Erro: não foi possível criar '" << out_path << "'." << std::endl;
+            return 1;
+        }
+        print_bench_report(out, results, format);
+    }
+
+    if (!baseline_path.empty() && check_regressions(baseline_path, results, tolerance_pct) > 0) {
+        return 2;
+    }
+    return 0;
+}
+
+// ==========================================
+// PARTE G: Servidor de Consultas (subcomando serve)
+// ==========================================
+
+/**
+ * O servidor cria P workers uma única vez e os mantém vivos. Master e
+ * workers se comunicam por dois anéis em memória compartilhada (mmap):
+ *
+ *   master --(jobs)--> workers --(results)--> master
+ *
+ * Cada anel é uma fila circular limitada de múltiplos produtores e
+ * múltiplos consumidores: o bloqueio fica por conta de dois semáforos
+ * POSIX compartilhados entre processos (vagas livres / itens prontos) e a
+ * posse de cada posição é decidida por tickets atômicos. Cada célula tem
+ * um número de sequência que diz se ela está livre para o ticket t
+ * (seq == t) ou preenchida por ele (seq == t + 1), o que impede que um
+ * produtor sobrescreva uma célula que um consumidor mais lento ainda não leu.
+ */
+constexpr uint64_t SERVE_RING_SLOTS = 1024;
+constexpr uint64_t SERVE_STOP = UINT64_MAX; // id especial: encerra worker / fim da entrada
+
+struct ServeJob {
+    uint64_t id;
+    uint64_t a, b;
+    int64_t submit_ns;
+};
+
+struct ServeResult {
+    uint64_t id;
+    uint64_t a, b;
+    long long primes;
+    int64_t submit_ns;
+    int worker;
+};
+
+template <typename T>
+struct ShmRing {
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> seq;
+        T data;
+    };
+
+    sem_t free_slots;
+    sem_t ready;
+    alignas(64) std::atomic<uint64_t> head; // Próximo ticket de produtor
+    alignas(64) std::atomic<uint64_t> tail; // Próximo ticket de consumidor
+    Cell cells[SERVE_RING_SLOTS];
+
+    void init() {
+        sem_init(&free_slots, 1, SERVE_RING_SLOTS);
+        sem_init(&ready, 1, 0);
+        head.store(0);
+        tail.store(0);
+        for (uint64_t i = 0; i < SERVE_RING_SLOTS; i++) cells[i].seq.store(i);
+    }
+
+    void destroy() {
+        sem_destroy(&free_slots);
+        sem_destroy(&ready);
+    }
+
+    void push(const T& item) {
+        while (sem_wait(&free_slots) == -1 && errno == EINTR) {}
+        uint64_t ticket = head.fetch_add(1, std::memory_order_relaxed);
+        Cell& cell = cells[ticket % SERVE_RING_SLOTS];
+        while (cell.seq.load(std::memory_order_acquire) != ticket) sched_yield();
+        cell.data = item;
+        cell.seq.store(ticket + 1, std::memory_order_release);
+        sem_post(&ready);
+    }
+
+    void pop(T& item) {
+        while (sem_wait(&ready) == -1 && errno == EINTR) {}
+        uint64_t ticket = tail.fetch_add(1, std::memory_order_relaxed);
+        Cell& cell = cells[ticket % SERVE_RING_SLOTS];
+        while (cell.seq.load(std::memory_order_acquire) != ticket + 1) sched_yield();
+        item = cell.data;
+        cell.seq.store(ticket + SERVE_RING_SLOTS, std::memory_order_release);
+        sem_post(&free_slots);
+    }
+
+    bool empty() {
+        int value = 0;
+        sem_getvalue(&ready, &value);
+        return value <= 0;
+    }
+};
+
+struct ServeShared {
+    ShmRing<ServeJob> jobs;
+    ShmRing<ServeResult> results;
+};
+
+// Sinalizado por SIGINT/SIGTERM no master: encerra o servidor de forma ordenada
+volatile sig_atomic_t serve_stop_requested = 0;
+
+void serve_handle_signal(int) {
+    serve_stop_requested = 1;
+}
+
+/**
+ * Função: serve_worker
+ * --------------------
+ * Laço de um worker do servidor: retira consultas do anel de jobs, conta
+ * os primos de [a, b] e publica a resposta no anel de resultados, até
+ * receber o job de encerramento.
+ */
+void serve_worker(ServeShared* shared, int index, const std::string& algo) {
+    ServeJob job;
+    while (true) {
+        shared->jobs.pop(job);
+        if (job.id == SERVE_STOP) break;
+
+        ServeResult result;
+        result.id = job.id;
+        result.a = job.a;
+        result.b = job.b;
+        result.primes = count_primes_interval(job.a, job.b, algo);
+        result.submit_ns = job.submit_ns;
+        result.worker = index;
+        shared->results.push(result);
+    }
+}
+
+/**
+ * Função: parse_serve_query
+ * -------------------------
+ * Interpreta uma linha de consulta: "a b" para [a, b] ou apenas "b" para
+ * [2, b]. Linhas vazias e comentários (#) são ignorados (retorna 0);
+ * retorna -1 em erro e 1 para uma consulta válida.
+ */
+int parse_serve_query(const std::string& line, uint64_t& a, uint64_t& b, std::string& error) {
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t begin = line.find_first_not_of(" \t\r\n,[]", pos);
+        if (begin == std::string::npos || line[begin] == '#') break;
+        size_t end = line.find_first_of(" \t\r\n,[]", begin);
+        if (end == std::string::npos) end = line.size();
+        tokens.push_back(line.substr(begin, end - begin));
+        pos = end;
+    }
+    if (tokens.empty()) return 0;
+    if (tokens.size() > 2) {
+        error = "esperado 'a b' ou 'b'";
+        return -1;
+    }
+
+    a = 2;
+    if (!parse_u64(tokens[0], tokens.size() == 2 ? a : b) ||
+        (tokens.size() == 2 && !parse_u64(tokens[1], b))) {
+        error = "limites devem ser inteiros";
+        return -1;
+    }
+    if (b > MAX_N) {
+        error = "b deve ser < 2^63";
+        return -1;
+    }
+    if (a < 2) a = 2;
+    if (a > b) {
+        error = "a deve ser <= b";
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * Função: serve_stream
+ * --------------------
+ * Atende um fluxo de consultas (stdin ou uma conexão do socket). A thread
+ * atual lê as linhas e publica os jobs; uma thread de escrita recebe as
+ * respostas na ordem em que terminam e as imprime no formato
+ * "id=... a=... b=... primes=... worker=... latency_us=...". O id é o
+ * número de ordem da consulta, para casar respostas fora de ordem. A saída
+ * é descarregada sempre que não há mais respostas prontas, de modo que um
+ * lote grande sai em poucas escritas.
+ */
+void serve_stream(ServeShared* shared, FILE* in, FILE* out) {
+    std::mutex out_lock;
+    uint64_t answered = 0;
+    double latency_sum_us = 0;
+
+    std::thread writer([&]() {
+        uint64_t expected = SERVE_STOP;
+        ServeResult result;
+        while (answered != expected) {
+            shared->results.pop(result);
+            std::lock_guard<std::mutex> guard(out_lock);
+            if (result.id == SERVE_STOP) {
+                expected = result.a; // Fim da entrada: 'a' traz o total de consultas
+            } else {
+                double latency_us = (now_ns() - result.submit_ns) / 1e3;
+                latency_sum_us += latency_us;
+                answered++;
+                fprintf(out, "id=%llu a=%llu b=%llu primes=%lld worker=%d latency_us=%.1f\n",
+                        (unsigned long long)result.id, (unsigned long long)result.a,
+                        (unsigned long long)result.b, result.primes, result.worker, latency_us);
+            }
+            if (shared->results.empty()) fflush(out);
+        }
+        fflush(out);
+    });
+
+    uint64_t submitted = 0, line_no = 0;
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    while (getline(&buffer, &capacity, in) != -1) {
+        uint64_t a = 0, b = 0;
+        std::string error;
+        line_no++;
+        int status = parse_serve_query(buffer, a, b, error);
+        if (status == 0) continue;
+        if (status < 0) {
+            std::lock_guard<std::mutex> guard(out_lock);
+            fprintf(out, "erro linha=%llu: %s\n", (unsigned long long)line_no, error.c_str());
+            fflush(out);
+            continue;
+        }
+        shared->jobs.push(ServeJob{submitted++, a, b, now_ns()});
+    }
+    free(buffer);
+
+    // Marca o fim da entrada no próprio anel de resultados
+    ServeResult end_marker = ServeResult();
+    end_marker.id = SERVE_STOP;
+    end_marker.a = submitted;
+    shared->results.push(end_marker);
+    writer.join();
+
+    if (submitted > 0) {
+        fprintf(stderr, "serve: queries=%llu mean_latency_us=%.1f\n",
+                (unsigned long long)submitted, latency_sum_us / submitted);
+    }
+}
+
+/**
+ * Função: run_serve_command
+ * -------------------------
+ * Subcomando 'serve': "serve <P> [--algo A] [--socket caminho]". Sem
+ * --socket, lê as consultas de stdin e responde em stdout até EOF. Com
+ * --socket, escuta num socket Unix e atende uma conexão por vez, até
+ * receber SIGINT ou SIGTERM; os workers são então encerrados e o socket
+ * removido.
+ */
+int run_serve_command(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Erro: Modo 'serve' requer P." << std::endl;
+        return 1;
+    }
+
+    int P = 0;
+    try {
+        P = std::stoi(argv[2]);
+    } catch (...) {
+        std::cerr << "Erro: P deve ser inteiro." << std::endl;
+        return 1;
+    }
+    if (P < 1) {
+        std::cerr << "Erro: P deve ser >= 1." << std::endl;
+        return 1;
+    }
+
+    std::string algo = "basic", socket_path;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--algo" && i + 1 < argc) {
+            algo = argv[++i];
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else {
+            std::cerr << "Erro: opção desconhecida '" << arg << "'." << std::endl;
+            return 1;
+        }
+    }
+    if (!is_valid_algo(algo)) {
+        std::cerr << "Erro: algo deve ser 'basic', 'sieve', 'mr', 'lmo' ou 'simd'." << std::endl;
+        return 1;
+    }
+
+    void* region = mmap(NULL, sizeof(ServeShared), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        perror("Erro no mmap");
+        exit(1);
+    }
+    ServeShared* shared = new (region) ServeShared;
+    shared->jobs.init();
+    shared->results.init();
+
+    // Pré-fork: os workers nascem antes de qualquer thread do master
+    std::vector<pid_t> pids;
+    for (int i = 0; i < P; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("Erro no fork");
+            exit(1);
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGTERM); // Não sobrevive a um master morto com SIGKILL
+            serve_worker(shared, i, algo);
+            exit(0);
+        }
+        pids.push_back(pid);
+    }
+
+    // Sem SA_RESTART: o sinal interrompe accept/read e o laço principal termina
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serve_handle_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (socket_path.empty()) {
+        serve_stream(shared, stdin, stdout);
+    } else {
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener == -1) {
+            perror("Erro ao criar socket");
+            exit(1);
+        }
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Erro: caminho do socket muito longo." << std::endl;
+            return 1;
+        }
+        strcpy(addr.sun_path, socket_path.c_str());
+        unlink(socket_path.c_str());
+        if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(listener, 16) == -1) {
+            perror("Erro ao escutar no socket");
+            exit(1);
+        }
+        std::cerr << "serve: P=" << P << " algo=" << algo << " socket=" << socket_path << std::endl;
+
+        while (!serve_stop_requested) {
+            int conn = accept(listener, NULL, NULL);
+            if (conn == -1) {
+                if (errno == EINTR) continue;
+                perror("Erro no accept");
+                break;
+            }
+            FILE* in = fdopen(conn, "r");
+            FILE* out = fdopen(dup(conn), "w");
+            serve_stream(shared, in, out);
+            fclose(out);
+            fclose(in);
+        }
+        close(listener);
+        unlink(socket_path.c_str());
+    }
+
+    // Encerramento: um job de parada por worker
+    for (int i = 0; i < P; i++) {
+        shared->jobs.push(ServeJob{SERVE_STOP, 0, 0, 0});
+    }
+    for (int i = 0; i < P; i++) {
+        wait(NULL);
+    }
+    shared->jobs.destroy();
+    shared->results.destroy();
+    munmap(region, sizeof(ServeShared));
+    return 0;
+}
+
+// ==========================================
+// PARTE H: Auto-Ajuste (subcomando tune)
+// ==========================================
+
+/**
+ * Estrutura: TuneProfile
+ * ----------------------
+ * Melhor configuração encontrada pelo 'tune' para um N alvo. O arquivo de
+ * perfil guarda uma linha "chave=valor" por N alvo, por exemplo:
+ *   n=1000000000 algo=sieve P=4 ipc=shm sched=dynamic blocks=32 segment=32768 est_ms=812.3
+ * 'ipc=threads' indica o modo par-threads; P=1 com ipc=none indica seq.
+ */
+struct TuneProfile {
+    uint64_t n = 0;
+    std::string algo = "basic";
+    int P = 1;
+    std::string ipc = "none";
+    std::string sched = "static";
+    uint64_t blocks = 32;
+    std::size_t segment = 32 * 1024;
+    double est_ms = 0;
+};
+
+/**
+ * Função: default_profile_path
+ * ----------------------------
+ * Caminho padrão do perfil: $PRIMECOUNT_PROFILE, ou ~/.primecount_profile.
+ */
+std::string default_profile_path() {
+    const char* env = getenv("PRIMECOUNT_PROFILE");
+    if (env != nullptr && env[0] != '\0') return env;
+    const char* home = getenv("HOME");
+    return std::string(home != nullptr ? home : ".") + "/.primecount_profile";
+}
+
+/**
+ * Função: load_profiles
+ * ---------------------
+ * Lê as linhas válidas do arquivo de perfil (comentários com '#' e chaves
+ * desconhecidas são ignorados). Um arquivo ausente devolve lista vazia.
+ */
+std::vector<TuneProfile> load_profiles(const std::string& path) {
+    std::vector<TuneProfile> profiles;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        TuneProfile profile;
+        bool has_n = false;
+        size_t pos = 0;
+        while (pos < line.size()) {
+            size_t begin = line.find_first_not_of(' ', pos);
+            if (begin == std::string::npos) break;
+            size_t end = line.find(' ', begin);
+            if (end == std::string::npos) end = line.size();
+            std::string field = line.substr(begin, end - begin);
+            pos = end;
+
+            size_t eq = field.find('=');
+            if (eq == std::string::npos) continue;
+            std::string key = field.substr(0, eq), value = field.substr(eq + 1);
+            uint64_t number = 0;
+            if (key == "n") has_n = parse_u64(value, profile.n);
+            else if (key == "algo") profile.algo = value;
+            else if (key == "P") profile.P = std::max(1, std::atoi(value.c_str()));
+            else if (key == "ipc") profile.ipc = value;
+            else if (key == "sched") profile.sched = value;
+            else if (key == "blocks" && parse_u64(value, number) && number > 0) profile.blocks = number;
+            else if (key == "segment" && parse_u64(value, number) && number > 0) profile.segment = number;
+            else if (key == "est_ms") profile.est_ms = std::atof(value.c_str());
+        }
+        if (has_n && is_valid_algo(profile.algo)) profiles.push_back(profile);
+    }
+    return profiles;
+}
+
+/**
+ * Função: pick_profile
+ * --------------------
+ * Escolhe a entrada mais adequada para N: a de menor n alvo que ainda
+ * cobre N, ou, se N passar de todas, a de maior n alvo.
+ */
+const TuneProfile* pick_profile(const std::vector<TuneProfile>& profiles, uint64_t N) {
+    const TuneProfile* covering = nullptr;
+    const TuneProfile* largest = nullptr;
+    for (const TuneProfile& profile : profiles) {
+        if (profile.n >= N && (covering == nullptr || profile.n < covering->n)) covering = &profile;
+        if (largest == nullptr || profile.n > largest->n) largest = &profile;
+    }
+    return covering != nullptr ? covering : largest;
+}
+
+/**
+ * Função: time_seq_ms
+ * -------------------
+ * Mede, no próprio processo, a contagem sequencial de [from, N].
+ */
+double time_seq_ms(uint64_t from, uint64_t N, const std::string& algo) {
+    auto start_time = std::chrono::steady_clock::now();
+    volatile long long primes = count_primes_interval(from, N, algo);
+    (void)primes;
+    auto end_time = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end_time - start_time).count();
+}
+
+/**
+ * Função: probe_config
+ * --------------------
+ * Melhor tempo (mínimo de 'reps' execuções isoladas em processo filho) de
+ * uma configuração sobre [from, N].
+ */
+double probe_config(const std::string& mode, uint64_t from, uint64_t N, int P,
+                    const std::string& ipc, const RunOptions& opts, int reps) {
+    double best = 0;
+    for (int r = 0; r < reps; r++) {
+        double elapsed = measure_once(mode, N, P, ipc, opts, from).elapsed_ms;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+/**
+ * Função: tune_target
+ * -------------------
+ * Calibra a melhor configuração para contar [2, N], em três etapas curtas:
+ * 1. Kernel: mede cada algoritmo numa janela no topo do intervalo (onde
+ *    cada número é mais caro), dobrando a janela até a medida passar de
+ *    ~20 ms, e projeta o custo para [2, N]. O lmo, sublinear, é medido em
+ *    x0 = min(N, 10^9) e projetado por (N/x0)^(2/3).
+ * 2. Segmento do crivo (só se o kernel escolhido for sieve).
+ * 3. Paralelismo, por busca coordenada numa janela de ~probe_ms de
+ *    trabalho sequencial: primeiro P (com shm estático), depois o IPC com
+ *    esse P e por fim o escalonamento e a granularidade dos blocos.
+ */
+TuneProfile tune_target(uint64_t N, double probe_ms, int reps) {
+    TuneProfile best;
+    best.n = N;
+
+    // Etapa 1: kernel
+    double best_cost = -1;        // ms por número (ou projeção total, no lmo)
+    double best_projection = 0;
+    std::vector<std::string> kernels;
+    if (N <= 1000000000000ULL) kernels.push_back("basic");
+    if (N <= UINT32_MAX) kernels.push_back("simd");
+    kernels.push_back("mr");
+    if (isqrt_u64(N) <= 100000000ULL) kernels.push_back("sieve"); // Tabela de primos-base <= 100 MB
+
+    for (const std::string& algo : kernels) {
+        uint64_t window = std::min<uint64_t>(1024, N - 1);
+        double elapsed = 0;
+        while (true) {
+            elapsed = time_seq_ms(N - window + 1, N, algo);
+            if (elapsed >= 20.0 || window >= N - 1) break;
+            window = std::min<uint64_t>(window * 2, N - 1);
+        }
+        double cost = elapsed / window;
+        double projection = cost * (N - 1);
+        fprintf(stderr, "tune: N=%llu kernel=%-5s janela=%llu %.2f ms -> projeção %.1f ms\n",
+                (unsigned long long)N, algo.c_str(), (unsigned long long)window, elapsed, projection);
+        if (best_cost < 0 || projection < best_projection) {
+            best_cost = cost;
+            best_projection = projection;
+            best.algo = algo;
+        }
+    }
+    if (N >= LMO_MIN_X) {
+        uint64_t x0 = std::min<uint64_t>(N, 1000000000ULL);
+        double elapsed = time_seq_ms(2, x0, "lmo");
+        double projection = elapsed * std::pow((double)N / x0, 2.0 / 3.0);
+        fprintf(stderr, "tune: N=%llu kernel=lmo   x0=%llu %.2f ms -> projeção %.1f ms\n",
+                (unsigned long long)N, (unsigned long long)x0, elapsed, projection);
+        if (projection < best_projection) {
+            best_projection = projection;
+            best.algo = "lmo";
+        }
+    }
+
+    // Janela das etapas 2 e 3: ~probe_ms de trabalho sequencial (lmo: x0 inteiro)
+    uint64_t probe_from = 2, probe_to = N;
+    if (best.algo == "lmo") {
+        probe_to = std::min<uint64_t>(N, 1000000000ULL);
+    } else {
+        uint64_t window = std::max<uint64_t>((uint64_t)(probe_ms / best_cost), 4096);
+        if (window < N - 1) probe_from = N - window + 1;
+    }
+    double scale = best_projection / std::max(time_seq_ms(probe_from, probe_to, best.algo), 1e-3);
+
+    RunOptions opts;
+    opts.algo = best.algo;
+
+    // Etapa 2: segmento do crivo
+    if (best.algo == "sieve") {
+        double best_ms = -1;
+        for (std::size_t segment = 16 * 1024; segment <= 512 * 1024; segment *= 2) {
+            sieve_segment_bytes = segment;
+            double elapsed = probe_config("seq", probe_from, probe_to, 1, "none", opts, reps);
+            fprintf(stderr, "tune: N=%llu segment=%zu %.2f ms\n", (unsigned long long)N, segment, elapsed);
+            if (best_ms < 0 || elapsed < best_ms) {
+                best_ms = elapsed;
+                best.segment = segment;
+            }
+        }
+        sieve_segment_bytes = best.segment;
+    }
+
+    // Etapa 3: paralelismo (P, depois IPC, depois escalonamento)
+    double best_ms = probe_config("seq", probe_from, probe_to, 1, "none", opts, reps);
+    fprintf(stderr, "tune: N=%llu seq %.2f ms\n", (unsigned long long)N, best_ms);
+    int cpus = (int)std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+
+    int best_P = 1;
+    for (int P = 2; P <= 2 * cpus || P <= 2; P *= 2) {
+        double elapsed = probe_config("par", probe_from, probe_to, P, "shm", opts, reps);
+        fprintf(stderr, "tune: N=%llu par P=%d ipc=shm %.2f ms\n", (unsigned long long)N, P, elapsed);
+        if (elapsed < best_ms) {
+            best_ms = elapsed;
+            best_P = P;
+            best.P = P;
+            best.ipc = "shm";
+        }
+    }
+
+    if (best_P > 1) {
+        for (const char* ipc : {"pipe", "futex", "eventfd", "threads"}) {
+            std::string mode = std::string(ipc) == "threads" ? "par-threads" : "par";
+            double elapsed = probe_config(mode, probe_from, probe_to, best_P, ipc, opts, reps);
+            fprintf(stderr, "tune: N=%llu par P=%d ipc=%s %.2f ms\n", (unsigned long long)N, best_P, ipc, elapsed);
+            if (elapsed < best_ms) {
+                best_ms = elapsed;
+                best.ipc = ipc;
+            }
+        }
+
+        // par-threads sempre reparte em blocos (a referência já mediu 32 por
+        // thread); com processos, a referência é o estático e testam-se
+        // dynamic/guided em várias granularidades
+        bool threads = (best.ipc == "threads");
+        std::vector<std::string> scheds = {"static"};
+        if (!threads) scheds = {"dynamic", "guided"};
+        std::string mode = threads ? "par-threads" : "par";
+        for (const std::string& sched : scheds) {
+            for (uint64_t blocks : {8, 32, 128}) {
+                if (threads && blocks == 32) continue;
+                opts.sched = sched;
+                opts.blocks_per_worker = blocks;
+                double elapsed = probe_config(mode, probe_from, probe_to, best_P, best.ipc, opts, reps);
+                fprintf(stderr, "tune: N=%llu par P=%d ipc=%s sched=%s blocks=%llu %.2f ms\n",
+                        (unsigned long long)N, best_P, best.ipc.c_str(), sched.c_str(),
+                        (unsigned long long)blocks, elapsed);
+                if (elapsed < best_ms) {
+                    best_ms = elapsed;
+                    best.sched = sched;
+                    best.blocks = blocks;
+                }
+            }
+        }
+    }
+
+    best.est_ms = best_ms * scale;
+    sieve_segment_bytes = 32 * 1024;
+    return best;
+}
+
+/**
+ * Função: run_tune_command
+ * ------------------------
+ * Subcomando 'tune': "tune [--N <lista>] [--profile <arquivo>]
+ * [--probe-ms <ms>] [--reps <R>]". Calibra cada N alvo e grava o perfil
+ * (substituindo as entradas antigas dos mesmos N) que 'seq' e 'par'
+ * carregam quando as opções correspondentes são omitidas.
+ */
+int run_tune_command(int argc, char* argv[]) {
+    std::vector<std::string> n_list = {"10000000"};
+    std::string profile_path = default_profile_path();
+    double probe_ms = 200.0;
+    int reps = 2;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Erro: opção '" << arg << "' requer um valor." << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--N") n_list = split_list(value);
+        else if (arg == "--profile") profile_path = value;
+        else if (arg == "--probe-ms") probe_ms = std::atof(value.c_str());
+        else if (arg == "--reps") reps = std::atoi(value.c_str());
+        else {
+            std::cerr << "Erro: opção desconhecida '" << arg << "'." << std::endl;
+            return 1;
+        }
+    }
+    if (probe_ms <= 0 || reps < 1) {
+        std::cerr << "Erro: probe-ms deve ser > 0 e reps >= 1." << std::endl;
+        return 1;
+    }
+
+    std::vector<TuneProfile> profiles = load_profiles(profile_path);
+    for (const std::string& n_text : n_list) {
+        uint64_t N = 0;
+        if (!parse_u64(n_text, N) || N < 2 || N > MAX_N) {
+            std::cerr << "Erro: N inválido '" << n_text << "'." << std::endl;
+            return 1;
+        }
+        TuneProfile tuned = tune_target(N, probe_ms, reps);
+        profiles.erase(std::remove_if(profiles.begin(), profiles.end(),
+                                      [N](const TuneProfile& p) { return p.n == N; }),
+                       profiles.end());
+        profiles.push_back(tuned);
+    }
+    std::sort(profiles.begin(), profiles.end(),
+              [](const TuneProfile& x, const TuneProfile& y) { return x.n < y.n; });
+
+    std::ofstream out(profile_path);
+    if (!out) {
+        std::cerr << "Erro: não foi possível criar '" << profile_path << "'." << std::endl;
+        return 1;
+    }
+    out << "# perfil do primecount (gerado por 'primecount tune'; uma linha por N alvo)\n";
+    for (const TuneProfile& p : profiles) {
+        char line[256];
+        snprintf(line, sizeof(line), "n=%llu algo=%s P=%d ipc=%s sched=%s blocks=%llu segment=%zu est_ms=%.1f\n",
+                 (unsigned long long)p.n, p.algo.c_str(), p.P, p.ipc.c_str(), p.sched.c_str(),
+                 (unsigned long long)p.blocks, p.segment, p.est_ms);
+        out << line;
+        std::cout << line;
+    }
+    std::cerr << "tune: perfil gravado em " << profile_path << std::endl;
+    return 0;
+}
+
+// ==========================================
+// PARTE I: Distribuição entre Máquinas (coordinator / worker)
+// ==========================================
+
+/**
+ * Protocolo texto, uma mensagem por linha, sobre TCP ou socket Unix:
+ *
+ *   worker -> coordinator   HELLO <host> <pid>
+ *   coordinator -> worker   CONFIG <algo>
+ *   worker -> coordinator   LEASE                 (pede um intervalo)
+ *   coordinator -> worker   RANGE <id> <a> <b>    (concessão do intervalo [a, b])
+ *                           WAIT                  (tudo concedido; pergunte de novo)
+ *                           DONE                  (contagem encerrada)
+ *   worker -> coordinator   RESULT <id> <primos>
+ *
+ * Cada concessão (lease) tem prazo. Se o worker desconecta ou estoura o
+ * prazo, o intervalo volta para a fila e é concedido a outro; o primeiro
+ * RESULT que chegar para um lease é o que vale (duplicatas são ignoradas).
+ */
+
+/**
+ * Estrutura: Endpoint
+ * -------------------
+ * Endereço no formato "tcp:host:porta" ou "unix:caminho".
+ */
+struct Endpoint {
+    bool is_unix = false;
+    std::string host;
+    std::string port;
+    std::string path;
+};
+
+bool parse_endpoint(const std::string& text, Endpoint& endpoint) {
+    if (text.rfind("unix:", 0) == 0) {
+        endpoint.is_unix = true;
+        endpoint.path = text.substr(5);
+        return !endpoint.path.empty();
+    }
+    if (text.rfind("tcp:", 0) == 0) {
+        size_t colon = text.rfind(':');
+        if (colon <= 4) return false;
+        endpoint.host = text.substr(4, colon - 4);
+        endpoint.port = text.substr(colon + 1);
+        return !endpoint.host.empty() && !endpoint.port.empty();
+    }
+    return false;
+}
+
+/**
+ * Função: open_endpoint
+ * ---------------------
+ * Cria o socket do endpoint: escutando ('listen' = true) ou conectado.
+ * Retorna -1 em erro (com a causa em errno).
+ */
+int open_endpoint(const Endpoint& endpoint, bool listen_mode) {
+    if (endpoint.is_unix) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (endpoint.path.size() >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(addr.sun_path, endpoint.path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) return -1;
+        if (listen_mode) {
+            unlink(endpoint.path.c_str());
+            if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 && listen(fd, 64) == 0) return fd;
+        } else if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        return -1;
+    }
+
+    struct addrinfo hints, *results = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listen_mode ? AI_PASSIVE : 0;
+    if (getaddrinfo(endpoint.host.c_str(), endpoint.port.c_str(), &hints, &results) != 0) {
+        errno = EADDRNOTAVAIL;
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo* ai = results; ai != nullptr; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd == -1) continue;
+        int one = 1;
+        if (listen_mode) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) break;
+        } else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(results);
+    return fd;
+}
+
+/**
+ * Função: send_line
+ * -----------------
+ * Envia uma linha inteira (acrescenta '\n'). Retorna false se a conexão caiu.
+ */
+bool send_line(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * Função: read_lines
+ * ------------------
+ * Lê o que estiver disponível em 'fd', acumula em 'buffer' e move as
+ * linhas completas para 'lines'. Retorna false em EOF ou erro.
  */
-long long run_sequential(int N) {
-    // Conta primos no intervalo completo [2, N]
-    return count_primes_interval(2, N);
+bool read_lines(int fd, std::string& buffer, std::vector<std::string>& lines) {
+    char chunk[4096];
+    ssize_t n;
+    do {
+        n = recv(fd, chunk, sizeof(chunk), 0);
+    } while (n == -1 && errno == EINTR);
+    if (n <= 0) return false;
+    buffer.append(chunk, (size_t)n);
+    size_t newline;
+    while ((newline = buffer.find('\n')) != std::string::npos) {
+        lines.push_back(buffer.substr(0, newline));
+        buffer.erase(0, newline + 1);
+    }
+    return true;
 }
 
-// ==========================================
-// PARTE C: Implementação CONCORRENTE
-// ==========================================
-
 /**
- * Função: run_concurrent
- * ----------------------
- * Gerencia a execução concorrente utilizando múltiplos processos.
- * Passos principais:
- * 1. Divide o intervalo total de busca de primos entre os processos.
- * 2. Configura o mecanismo de comunicação (Pipe ou Memória Compartilhada).
- * 3. Cria processos filhos (fork), um por fatia de intervalo.
- * 4. Cada filho calcula a quantidade de primos em sua fatia.
- * 5. O processo pai sincroniza, coleta e agrega os resultados parciais.
+ * Estrutura: Lease
+ * ----------------
+ * Intervalo concedido (ou a conceder) pelo coordinator.
  */
-long long run_concurrent(int N, int P, const std::string& ipc_type) {
-    // ---------------------------------------------------------
-    // 1. Definição dos Intervalos (Balanceamento de Carga)
-    // ---------------------------------------------------------
-    // O intervalo de interesse é [2, N].
-    int total_numbers = N - 1;            // Quantidade total de números a verificar
-    int base_chunk_size = total_numbers / P; // Tamanho base da fatia para cada processo
-    int extra_numbers = total_numbers % P;   // Números "a mais" distribuídos entre os primeiros processos
+struct Lease {
+    uint64_t start, end;
+    int owner_fd = -1;       // Conexão do worker atual; -1 = livre
+    int64_t deadline_ns = 0; // Prazo da concessão atual
+    bool done = false;
+};
 
-    // ---------------------------------------------------------
-    // 2. Setup do IPC (Inter-Process Communication)
-    // ---------------------------------------------------------
-    int** ipc_pipes = nullptr;      // Matriz para armazenar descritores de arquivo (se usar Pipe)
-    long long* shared_results = nullptr;  // Ponteiro para a memória compartilhada (se usar SHM)
+struct CoordinatorClient {
+    std::string buffer;
+    std::string name;
+    uint64_t leases_done = 0;
+};
 
-    if (ipc_type == "pipe") {
-        // Aloca array de ponteiros para os pipes
-        ipc_pipes = new int*[P];
-        for (int i = 0; i < P; i++) {
-            ipc_pipes[i] = new int[2]; // Cada pipe tem 2 descritores: [0]=leitura, [1]=escrita
-            // Cria o pipe. Se falhar, encerra.
-            if (pipe(ipc_pipes[i]) == -1) {
-                perror("Erro ao criar pipe");
-                exit(1);
-            }
+/**
+ * Função: run_coordinator_command
+ * -------------------------------
+ * Subcomando 'coordinator': "coordinator <N> --listen <endpoint> [--from A]
+ * [--algo A] [--lease <números>] [--timeout <s>] [--spawn K]". Divide
+ * [from, N] em leases de tamanho fixo, concedidos sob demanda (como o
+ * escalonamento dynamic), reconcede os de workers que somem e soma os
+ * resultados. --spawn K cria K workers locais, para testar numa só máquina.
+ * Um único laço de poll atende o socket de escuta e todas as conexões.
+ */
+int run_coordinator_command(int argc, char* argv[]) {
+    uint64_t N = 0, from = 2, lease_size = 0;
+    if (argc < 3 || !parse_u64(argv[2], N) || N < 2 || N > MAX_N) {
+        std::cerr << "Erro: Modo 'coordinator' requer N (inteiro >= 2 e < 2^63)." << std::endl;
+        return 1;
+    }
+    std::string listen_text, algo = "sieve";
+    uint64_t timeout_s = 60, spawn = 0;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Erro: opção '" << arg << "' requer um valor." << std::endl;
+            return 1;
         }
-    } else if (ipc_type == "shm") {
-        // Configura Memória Compartilhada usando mmap.
-        // MAP_SHARED: As alterações são visíveis para outros processos mapeando a mesma região.
-        // MAP_ANONYMOUS: A memória não é baseada em arquivo, é criada na RAM e zerada.
-        // PROT_READ | PROT_WRITE: Permissão de leitura e escrita.
-        size_t shm_size = sizeof(long long) * P; // Espaço para um contador (long long) por processo
-        shared_results = (long long*)mmap(NULL, shm_size, PROT_READ | PROT_WRITE, 
-                                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-        
-        if (shared_results == MAP_FAILED) {
-            perror("Erro no mmap");
-            exit(1);
+        std::string value = argv[++i];
+        bool parsed = true;
+        if (arg == "--listen") listen_text = value;
+        else if (arg == "--from") parsed = parse_u64(value, from);
+        else if (arg == "--algo") algo = value;
+        else if (arg == "--lease") parsed = parse_u64(value, lease_size);
+        else if (arg == "--timeout") parsed = parse_u64(value, timeout_s);
+        else if (arg == "--spawn") parsed = parse_u64(value, spawn);
+        else {
+            std::cerr << "Erro: opção desconhecida '" << arg << "'." << std::endl;
+            return 1;
         }
-    } else {
-        std::cerr << "IPC invalido (use 'pipe' ou 'shm')" << std::endl;
-        exit(1);
+        if (!parsed) {
+            std::cerr << "Erro: " << arg << " deve ser inteiro." << std::endl;
+            return 1;
+        }
+    }
+    Endpoint endpoint;
+    if (!parse_endpoint(listen_text, endpoint)) {
+        std::cerr << "Erro: --listen deve ser 'tcp:host:porta' ou 'unix:caminho'." << std::endl;
+        return 1;
+    }
+    if (!is_valid_algo(algo) || algo == "lmo") {
+        std::cerr << "Erro: algo deve ser 'basic', 'sieve', 'mr' ou 'simd'." << std::endl;
+        return 1;
+    }
+    if (from < 2 || from > N || timeout_s < 1 || timeout_s > INT_MAX || spawn > INT_MAX) {
+        std::cerr << "Erro: requer 2 <= from <= N, 1 <= timeout <= " << INT_MAX
+                  << " e spawn <= " << INT_MAX << "." << std::endl;
+        return 1;
     }
 
-    // ---------------------------------------------------------
-    // 3. Loop de Criação de Processos (Fork)
-    // ---------------------------------------------------------
-    int current_start = 2; // Início do próximo subintervalo a ser atribuído
+    // Leases de tamanho fixo; padrão ~1024 leases (mínimo de 4096 números)
+    uint64_t total_numbers = N - from + 1;
+    if (lease_size == 0) lease_size = resolve_chunk_size(total_numbers, 32, 0);
+    std::vector<Lease> leases;
+    for (uint64_t start = from; start <= N; start += lease_size) {
+        leases.push_back(Lease{start, std::min<uint64_t>(start + (lease_size - 1), N)});
+        if (leases.back().end == N) break;
+    }
 
-    for (int i = 0; i < P; i++) {
-        // Calcula onde começa e termina o intervalo do processo 'i'
-        // Distribui o 'remainder' dando 1 número extra para os primeiros processos
-        int chunk_size = base_chunk_size + (i < extra_numbers ? 1 : 0);
-        int current_end = current_start + chunk_size - 1;
+    int listener = open_endpoint(endpoint, true);
+    if (listener == -1) {
+        perror("Erro ao escutar no endpoint");
+        exit(1);
+    }
+    // Com "tcp:host:0" o kernel escolhe a porta: anuncia (e passa aos
+    // workers do --spawn) a porta de fato usada, e não a 0
+    if (!endpoint.is_unix) {
+        struct sockaddr_storage bound;
+        socklen_t bound_len = sizeof(bound);
+        char port[NI_MAXSERV];
+        if (getsockname(listener, (struct sockaddr*)&bound, &bound_len) == 0 &&
+            getnameinfo((struct sockaddr*)&bound, bound_len, NULL, 0, port, sizeof(port),
+                        NI_NUMERICSERV) == 0) {
+            listen_text = "tcp:" + endpoint.host + ":" + port;
+        }
+    }
+    std::cerr << "coordinator: N=" << N << " leases=" << leases.size() << " lease=" << lease_size
+              << " escutando em " << listen_text << std::endl;
 
-        // Cria um novo processo duplicando o atual
+    auto start_time = std::chrono::steady_clock::now();
+    std::vector<pid_t> spawned;
+    for (uint64_t k = 0; k < spawn; k++) {
         pid_t pid = fork();
-
         if (pid < 0) {
             perror("Erro no fork");
             exit(1);
-        } 
-        else if (pid == 0) {
-            // =====================================================
-            // CÓDIGO DO PROCESSO FILHO (WORKER)
-            // =====================================================
-            
-            // Gerenciamento de Pipes no Filho
-            if (ipc_type == "pipe") {
-                for (int j = 0; j < P; j++) {
-                    close(ipc_pipes[j][0]); // Filho NUNCA lê do pipe, fecha leitura
-                    if (j != i) close(ipc_pipes[j][1]); // Fecha escrita dos pipes dos IRMÃOS
-                }
+        }
+        if (pid == 0) {
+            execl("/proc/self/exe", argv[0], "worker", "--connect", listen_text.c_str(), (char*)NULL);
+            perror("Erro no exec do worker");
+            _exit(1);
+        }
+        spawned.push_back(pid);
+    }
+
+    std::map<int, CoordinatorClient> clients;
+    std::deque<size_t> pending;                 // Leases a conceder, em ordem
+    for (size_t k = 0; k < leases.size(); k++) pending.push_back(k);
+    size_t completed = 0;
+    uint64_t reissued = 0, workers_seen = 0;
+    long long total_primes = 0;
+
+    auto release_leases = [&](int fd, const char* reason) {
+        for (size_t k = 0; k < leases.size(); k++) {
+            if (leases[k].owner_fd == fd && !leases[k].done) {
+                leases[k].owner_fd = -1;
+                pending.push_front(k);
+                reissued++;
+                std::cerr << "coordinator: lease " << k << " reconcedido (" << reason << ")" << std::endl;
             }
+        }
+    };
+    auto drop_client = [&](int fd) {
+        release_leases(fd, "worker desconectou");
+        close(fd);
+        clients.erase(fd);
+    };
 
-            // Realiza o trabalho pesado (CPU-bound)
-            long long primes_found = count_primes_interval(current_start, current_end);
+    while (completed < leases.size()) {
+        std::vector<struct pollfd> fds;
+        fds.push_back({listener, POLLIN, 0});
+        for (auto& entry : clients) fds.push_back({entry.first, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), 1000) == -1 && errno != EINTR) {
+            perror("Erro no poll");
+            exit(1);
+        }
 
-            // Envia o resultado para o Pai
-            if (ipc_type == "pipe") {
-                // Escreve o resultado binário no pipe dedicado a este processo (i)
-                if (write(ipc_pipes[i][1], &primes_found, sizeof(long long)) == -1) {
-                    perror("Erro na escrita do pipe");
-                    exit(1);
-                }
-                close(ipc_pipes[i][1]); // Fecha a ponta de escrita após enviar (envia EOF)
-            } else if (ipc_type == "shm") {
-                // Escreve diretamente no slot do array compartilhado na memória
-                shared_results[i] = primes_found; 
+        if (fds[0].revents & POLLIN) {
+            int conn = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+            if (conn != -1) {
+                clients[conn] = CoordinatorClient();
+                workers_seen++;
             }
-            
-            // Limpeza de memória alocada no heap (herdada do pai) para evitar vazamento no valgrind
-            if (ipc_type == "pipe") {
-                for(int k=0; k<P; k++) delete[] ipc_pipes[k];
-                delete[] ipc_pipes;
+        }
+
+        for (size_t f = 1; f < fds.size(); f++) {
+            if (fds[f].revents == 0) continue;
+            int fd = fds[f].fd;
+            std::vector<std::string> lines;
+            if (!read_lines(fd, clients[fd].buffer, lines)) {
+                drop_client(fd);
+                continue;
             }
+            bool alive = true;
+            for (const std::string& line : lines) {
+                char command[16] = {0};
+                unsigned long long id = 0, value = 0;
+                if (sscanf(line.c_str(), "%15s", command) != 1) continue;
+                std::string cmd = command;
 
-            exit(0); // OBRIGATÓRIO: Filho termina aqui para não continuar o loop do pai
+                if (cmd == "HELLO") {
+                    clients[fd].name = line.size() > 6 ? line.substr(6) : "?";
+                    alive = send_line(fd, "CONFIG " + algo);
+                } else if (cmd == "LEASE") {
+                    if (pending.empty()) {
+                        alive = send_line(fd, completed == leases.size() ? "DONE" : "WAIT");
+                        continue;
+                    }
+                    size_t k = pending.front();
+                    pending.pop_front();
+                    leases[k].owner_fd = fd;
+                    leases[k].deadline_ns = now_ns() + (int64_t)timeout_s * 1000000000LL;
+                    alive = send_line(fd, "RANGE " + std::to_string(k) + " " + std::to_string(leases[k].start) +
+                                          " " + std::to_string(leases[k].end));
+                } else if (cmd == "RESULT" && sscanf(line.c_str(), "RESULT %llu %llu", &id, &value) == 2 &&
+                           id < leases.size()) {
+                    Lease& lease = leases[id];
+                    if (!lease.done) {
+                        lease.done = true;
+                        total_primes += (long long)value;
+                        completed++;
+                        clients[fd].leases_done++;
+                        // Se o lease estava na fila para reconcessão, sai dela
+                        pending.erase(std::remove(pending.begin(), pending.end(), (size_t)id), pending.end());
+                    }
+                    if (lease.owner_fd == fd) lease.owner_fd = -1;
+                }
+                if (!alive) break;
+            }
+            if (!alive) drop_client(fd);
         }
 
-        // =====================================================
-        // CÓDIGO DO PROCESSO PAI (MASTER) CONTINUAÇÃO DO LOOP
-        // =====================================================
-        
-        // Se usar pipe, pai fecha a ponta de ESCRITA deste pipe específico.
-        // Se o pai mantiver aberto, o 'read' nunca retornará 0 (EOF) se decidirmos ler em loop.
-        if (ipc_type == "pipe") {
-            close(ipc_pipes[i][1]);
+        // Prazos vencidos: o lease volta para a fila (o worker lento pode
+        // ainda responder; vale o primeiro resultado)
+        int64_t now = now_ns();
+        for (size_t k = 0; k < leases.size(); k++) {
+            if (!leases[k].done && leases[k].owner_fd != -1 && now > leases[k].deadline_ns) {
+                leases[k].owner_fd = -1;
+                pending.push_back(k);
+                reissued++;
+                std::cerr << "coordinator: lease " << k << " reconcedido (prazo vencido)" << std::endl;
+            }
         }
+    }
 
-        // Atualiza o início para o próximo worker
-        current_start = current_end + 1;
+    // Encerramento: avisa todos os workers conectados
+    for (auto& entry : clients) {
+        send_line(entry.first, "DONE");
+        close(entry.first);
     }
+    close(listener);
+    if (endpoint.is_unix) unlink(endpoint.path.c_str());
+    for (pid_t pid : spawned) waitpid(pid, NULL, 0);
 
-    // ---------------------------------------------------------
-    // 4. Sincronização e Agregação de Resultados
-    // ---------------------------------------------------------
-    long long total_primes = 0;
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "mode=coordinator N=" << N;
+    if (from != 2) std::cout << " from=" << from;
+    std::cout << " workers=" << workers_seen << " leases=" << leases.size() << " reissued=" << reissued
+              << " primes=" << total_primes << " time_ms=" << elapsed_ms << std::endl;
+    return 0;
+}
 
-    // Passo A: Esperar TODOS os filhos terminarem.
-    // Isso é crucial para evitar processos "zumbis" e garantir que todos calcularam.
-    for (int i = 0; i < P; i++) {
-        wait(NULL);
+/**
+ * Função: run_worker_command
+ * --------------------------
+ * Subcomando 'worker': "worker --connect <endpoint> [--threads T]". Pede
+ * leases ao coordinator até receber DONE. Com --threads T > 1, cada lease
+ * é contado pelo modo par-threads desta máquina. Tenta conectar por até
+ * 10 s, para poder ser iniciado antes do coordinator.
+ */
+int run_worker_command(int argc, char* argv[]) {
+    std::string connect_text;
+    int threads = 1;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--connect" && i + 1 < argc) connect_text = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else {
+            std::cerr << "Erro: opção desconhecida '" << arg << "'." << std::endl;
+            return 1;
+        }
+    }
+    Endpoint endpoint;
+    if (!parse_endpoint(connect_text, endpoint) || threads < 1) {
+        std::cerr << "Erro: worker requer --connect 'tcp:host:porta' ou 'unix:caminho' e threads >= 1." << std::endl;
+        return 1;
     }
 
-    // Passo B: Coletar e somar os resultados parciais
-    if (ipc_type == "pipe") {
-        for (int i = 0; i < P; i++) {
-            long long partial_primes = 0;
-            // Lê do pipe. O read retorna > 0 se leu bytes.
-            if (read(ipc_pipes[i][0], &partial_primes, sizeof(long long)) > 0) {
-                total_primes += partial_primes;
-            }
-            close(ipc_pipes[i][0]); // Fecha a ponta de leitura
-            delete[] ipc_pipes[i];  // Libera memória do par de inteiros
-        }
-        delete[] ipc_pipes; // Libera o array de ponteiros
-    } else if (ipc_type == "shm") {
-        // No caso de memória compartilhada, os dados já estão lá
-        for (int i = 0; i < P; i++) {
-            total_primes += shared_results[i];
+    int fd = -1;
+    for (int attempt = 0; attempt < 100 && fd == -1; attempt++) {
+        fd = open_endpoint(endpoint, false);
+        if (fd == -1) usleep(100000);
+    }
+    if (fd == -1) {
+        perror("Erro ao conectar ao coordinator");
+        return 1;
+    }
+
+    char host[256] = "?";
+    gethostname(host, sizeof(host) - 1);
+    RunOptions opts;
+    std::string buffer;
+    std::vector<std::string> lines;
+    uint64_t leases_done = 0;
+    long long primes_found = 0;
+
+    // Lê a próxima linha do coordinator, bloqueando
+    auto next_line = [&](std::string& line) {
+        while (lines.empty()) {
+            if (!read_lines(fd, buffer, lines)) return false;
         }
-        // Desfaz o mapeamento da memória (limpeza)
-        munmap(shared_results, sizeof(long long) * P);
+        line = lines.front();
+        lines.erase(lines.begin());
+        return true;
+    };
+
+    std::string line;
+    if (!send_line(fd, std::string("HELLO ") + host + " " + std::to_string(getpid())) ||
+        !next_line(line) || line.rfind("CONFIG ", 0) != 0) {
+        std::cerr << "Erro: coordinator não respondeu ao HELLO." << std::endl;
+        return 1;
+    }
+    opts.algo = line.substr(7);
+    if (!is_valid_algo(opts.algo)) {
+        std::cerr << "Erro: algoritmo desconhecido '" << opts.algo << "' vindo do coordinator." << std::endl;
+        return 1;
     }
 
-    return total_primes;
+    while (send_line(fd, "LEASE") && next_line(line)) {
+        unsigned long long id = 0, a = 0, b = 0;
+        if (line == "DONE") break;
+        if (line == "WAIT") {
+            usleep(100000);
+            continue;
+        }
+        if (sscanf(line.c_str(), "RANGE %llu %llu %llu", &id, &a, &b) != 3) {
+            std::cerr << "Erro: mensagem inesperada '" << line << "'." << std::endl;
+            return 1;
+        }
+        long long primes = threads > 1 ? run_threads(a, b, threads, opts)
+                                       : count_primes_interval(a, b, opts.algo);
+        if (!send_line(fd, "RESULT " + std::to_string(id) + " " + std::to_string(primes))) break;
+        leases_done++;
+        primes_found += primes;
+    }
+    close(fd);
+    std::cerr << "worker " << host << ":" << getpid() << ": leases=" << leases_done
+              << " primes=" << primes_found << std::endl;
+    return 0;
 }
 
 // ==========================================
@@ -248,15 +4118,73 @@ long long run_concurrent(int N, int P, const std::string& ipc_type) {
 // Função auxiliar para exibir a forma correta de uso do programa
 void print_usage(const char* prog_name) {
     std::cerr << "Uso:\n"
-              << "  Sequencial: " << prog_name << " seq <N> [--algo basic]\n"
-              << "  Paralelo:   " << prog_name << " par <N> <P> <IPC> [--algo basic]\n\n"
+              << "  Sequencial: " << prog_name << " seq <N> [--algo basic|sieve|mr|lmo|simd] [--from <A>] [--cache <arquivo>]\n"
+              << "                [--emit <arquivo> [--emit-format text|binary]]\n"
+              << "  Paralelo:   " << prog_name << " par <N> <P> <IPC> [--algo basic|sieve|mr|lmo|simd] [--from <A>]\n"
+              << "                [--sched static|dynamic|guided] [--chunk <C>]\n"
+              << "                [--stats] [--trace <arquivo.json>] [--cache <arquivo>] [--progress]\n"
+              << "                [--emit <arquivo> [--emit-format text|binary]]\n"
+              << "                [--pin compact|scatter|<lista>] [--hugepages off|thp|explicit]\n"
+              << "  Threads:    " << prog_name << " par-threads <N> <P> [--algo basic|sieve|mr|lmo|simd] [--from <A>]\n"
+              << "                [--chunk <C>] [--cache <arquivo>] [--pin ...] [--hugepages ...]\n"
+              << "  Benchmark:  " << prog_name << " bench [--N <lista>] [--P <lista>] [--ipc <lista>] [--algo <lista>]\n"
+              << "                [--warmup <W>] [--reps <R>] [--format csv|json] [--out <arquivo>]\n"
+              << "                [--baseline <csv>] [--tolerance <pct>]\n"
+              << "  Auto-ajuste: " << prog_name << " tune [--N <lista>] [--profile <arquivo>] [--probe-ms <ms>] [--reps <R>]\n"
+              << "                grava o perfil lido por seq/par quando --algo, --sched, --segment, P ou IPC são omitidos\n"
+              << "                (par <N> e par-threads <N> sem P/IPC; --no-profile ignora o perfil)\n"
+              << "  Coordinator: " << prog_name << " coordinator <N> --listen tcp:host:porta|unix:caminho [--from <A>]\n"
+              << "                [--algo basic|sieve|mr|simd] [--lease <números>] [--timeout <s>] [--spawn <K>]\n"
+              << "  Worker:     " << prog_name << " worker --connect tcp:host:porta|unix:caminho [--threads <T>]\n"
+              << "  Servidor:   " << prog_name << " serve <P> [--algo basic|sieve|mr|lmo|simd] [--socket <caminho>]\n"
+              << "                consultas 'a b' (ou 'b' para [2, b]), uma por linha, via stdin ou socket Unix\n\n"
               << "Argumentos:\n"
-              << "  N:    Inteiro >= 2\n"
+              << "  N:    Inteiro >= 2 e < 2^63 (aceita a forma abreviada, ex.: 1e18)\n"
+              << "  A:    Início do intervalo [A, N] (padrão: 2)\n"
               << "  P:    Inteiro >= 1\n"
-              << "  IPC:  'pipe' ou 'shm'\n";
+              << "  IPC:  'pipe', 'shm', 'futex' ou 'eventfd' (os dois últimos publicam parciais\n"
+              << "        durante a execução e o master agrega na ordem de conclusão)\n"
+              << "  algo: 'basic' (divisão por tentativas), 'sieve' (crivo segmentado)\n"
+              << "        'mr' (Miller-Rabin determinístico, para intervalos altos e esparsos)\n"
+              << "        'lmo' (pi(x) sublinear de Lagarias-Miller-Odlyzko)\n"
+              << "        ou 'simd' (divisão por tentativas vetorizada, AVX2/AVX-512)\n"
+              << "  sched: 'static' (fatias fixas, padrão), 'dynamic' (blocos de C números)\n"
+              << "         ou 'guided' (blocos decrescentes, nunca menores que C)\n"
+              << "  C:    Inteiro >= 1 (padrão: ~32 blocos por worker)\n"
+              << "  segment: bytes do segmento do crivo (padrão: 32768; --segment <bytes>)\n"
+              << "  perfil: $PRIMECOUNT_PROFILE ou ~/.primecount_profile (--profile <arquivo>)\n"
+              << "  stats: tabela por worker, latência de fork, desbalanceamento e agregação (stderr)\n"
+              << "  trace: grava a timeline no formato Chrome Trace (implica --stats)\n"
+              << "  progress: andamento, primos parciais e ETA em stderr (IPC futex/eventfd)\n"
+              << "  cache: arquivo com pi(x) a cada 2^24; só o trecho após o checkpoint mais próximo é contado\n"
+              << "  pin:  fixa cada worker numa CPU: 'compact' (um soquete por vez), 'scatter'\n"
+              << "        (alterna soquetes, núcleos físicos antes dos hyperthreads) ou lista (0,2,4-7)\n"
+              << "  hugepages: 'off' (padrão), 'thp' (madvise) ou 'explicit' (MAP_HUGETLB, recai em thp)\n"
+              << "  emit: grava os primos no arquivo (seq ou par com IPC shm); --emit-format text (padrão) ou binary (uint64)\n"
+              << "  bench: listas separadas por vírgula; IPC aceita também 'threads' (par-threads)\n";
 }
 
 int main(int argc, char* argv[]) {
+    // Subcomando de benchmark: tem a sua própria lista de opções
+    if (argc >= 2 && std::string(argv[1]) == "bench") {
+        return run_bench_command(argc, argv);
+    }
+    // Auto-ajuste: calibra e grava o perfil usado quando as opções são omitidas
+    if (argc >= 2 && std::string(argv[1]) == "tune") {
+        return run_tune_command(argc, argv);
+    }
+    // Distribuição entre máquinas: coordinator concede leases, workers contam
+    if (argc >= 2 && std::string(argv[1]) == "coordinator") {
+        return run_coordinator_command(argc, argv);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "worker") {
+        return run_worker_command(argc, argv);
+    }
+    // Servidor de consultas com workers pré-criados
+    if (argc >= 2 && std::string(argv[1]) == "serve") {
+        return run_serve_command(argc, argv);
+    }
+
     // Validação mínima da quantidade de argumentos fornecidos
     if (argc < 3) {
         print_usage(argv[0]);
@@ -265,12 +4193,11 @@ int main(int argc, char* argv[]) {
 
     // Leitura dos argumentos básicos obrigatórios
     std::string mode = argv[1];
-    int N = 0;
+    uint64_t N = 0;
+    uint64_t from = 2; // Início do intervalo; alterado por --from
     
     // Converte e valida N (limite superior da faixa de busca de primos)
-    try {
-        N = std::stoi(argv[2]);
-    } catch (...) {
+    if (!parse_u64(argv[2], N)) {
         std::cerr << "Erro: N deve ser inteiro." << std::endl;
         return 1;
     }
@@ -278,15 +4205,51 @@ int main(int argc, char* argv[]) {
         std::cerr << "Erro: N deve ser >= 2." << std::endl;
         return 1;
     }
+    if (N > MAX_N) {
+        std::cerr << "Erro: N deve ser < 2^63." << std::endl;
+        return 1;
+    }
 
     int P = 0;
     std::string ipc = "none";
-    std::string algo = "basic"; 
+    RunOptions opts;
+    std::string cache_path; // --cache: arquivo de checkpoints de π(x)
+    std::string profile_path = default_profile_path(); // Perfil do 'tune'
+    bool use_profile = true;
+    bool algo_given = false, sched_given = false, segment_given = false;
+    std::string emit_path;  // --emit: arquivo de saída com os primos
+    std::string emit_format = "text";
 
     int next_arg_idx = 3; // Índice para continuar a leitura de argumentos
 
-    // Validações específicas para o modo Paralelo
-    if (mode == "par") {
+    // P e IPC omitidos (próximo argumento ausente ou já uma opção "--..."):
+    // vêm do perfil gerado por 'tune'
+    bool from_profile = (mode == "par" || mode == "par-threads") &&
+                        (argc < 4 || std::string(argv[3]).rfind("--", 0) == 0);
+
+    // Validações específicas para os modos Paralelos
+    if (from_profile) {
+        next_arg_idx = 3;
+    } else if (mode == "par-threads") {
+        if (argc < 4) {
+            std::cerr << "Erro: Modo 'par-threads' requer P." << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        try {
+            P = std::stoi(argv[3]);
+        } catch (...) {
+            std::cerr << "Erro: P deve ser inteiro." << std::endl;
+            return 1;
+        }
+        if (P < 1) {
+            std::cerr << "Erro: P deve ser >= 1." << std::endl;
+            return 1;
+        }
+
+        next_arg_idx = 4;
+    } else if (mode == "par") {
         if (argc < 5) {
             std::cerr << "Erro: Modo 'par' requer P e IPC." << std::endl;
             print_usage(argv[0]);
@@ -305,26 +4268,166 @@ int main(int argc, char* argv[]) {
         }
 
         ipc = argv[4];
-        if (ipc != "pipe" && ipc != "shm") {
-            std::cerr << "Erro: IPC deve ser 'pipe' ou 'shm'." << std::endl;
+        if (ipc != "pipe" && ipc != "shm" && ipc != "futex" && ipc != "eventfd") {
+            std::cerr << "Erro: IPC deve ser 'pipe', 'shm', 'futex' ou 'eventfd'." << std::endl;
             return 1;
         }
         
         next_arg_idx = 5;
     } else if (mode != "seq") {
-        std::cerr << "Erro: Modo desconhecido (use 'seq' ou 'par')." << std::endl;
+        std::cerr << "Erro: Modo desconhecido (use 'seq', 'par' ou 'par-threads')." << std::endl;
         return 1;
     }
 
-    // Busca argumento opcional --algo (se existir)
+    // Busca argumentos opcionais (--algo, --from, --sched, --chunk, --stats, --trace, --cache, --emit,
+    // --pin, --hugepages)
     for (int i = next_arg_idx; i < argc; i++) {
         std::string arg = argv[i];
-        if (arg == "--algo" && i + 1 < argc) {
-            algo = argv[i + 1];
+        if (arg == "--no-profile") {
+            use_profile = false;
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[i + 1];
+            i++;
+        } else if (arg == "--segment" && i + 1 < argc) {
+            uint64_t segment = 0;
+            if (!parse_u64(argv[i + 1], segment) || segment < 1024 || segment > (64ULL << 20)) {
+                std::cerr << "Erro: segment deve ser inteiro entre 1024 e 67108864 bytes." << std::endl;
+                return 1;
+            }
+            sieve_segment_bytes = segment;
+            segment_given = true;
+            i++;
+        } else if (arg == "--stats") {
+            opts.stats = true;
+        } else if (arg == "--progress") {
+            opts.progress = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            opts.trace_path = argv[i + 1];
+            opts.stats = true;
+            i++;
+        } else if (arg == "--pin" && i + 1 < argc) {
+            opts.pin = argv[i + 1];
+            i++;
+        } else if (arg == "--hugepages" && i + 1 < argc) {
+            hugepage_policy = argv[i + 1];
+            i++;
+        } else if (arg == "--emit" && i + 1 < argc) {
+            emit_path = argv[i + 1];
+            i++;
+        } else if (arg == "--emit-format" && i + 1 < argc) {
+            emit_format = argv[i + 1];
+            i++;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_path = argv[i + 1];
+            i++;
+        } else if (arg == "--algo" && i + 1 < argc) {
+            opts.algo = argv[i + 1];
+            algo_given = true;
+            i++;
+        } else if (arg == "--sched" && i + 1 < argc) {
+            opts.sched = argv[i + 1];
+            sched_given = true;
+            i++;
+        } else if (arg == "--from" && i + 1 < argc) {
+            if (!parse_u64(argv[i + 1], from)) {
+                std::cerr << "Erro: from deve ser inteiro." << std::endl;
+                return 1;
+            }
+            i++;
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            if (!parse_u64(argv[i + 1], opts.chunk)) {
+                std::cerr << "Erro: chunk deve ser inteiro." << std::endl;
+                return 1;
+            }
+            if (opts.chunk < 1) {
+                std::cerr << "Erro: chunk deve ser >= 1." << std::endl;
+                return 1;
+            }
             i++;
         }
     }
 
+    // Perfil do 'tune': preenche apenas o que não foi dado na linha de comando
+    const TuneProfile* profile = nullptr;
+    std::vector<TuneProfile> profiles;
+    if (use_profile) {
+        profiles = load_profiles(profile_path);
+        profile = pick_profile(profiles, N);
+    }
+    if (from_profile && profile == nullptr) {
+        std::cerr << "Erro: Modo '" << mode << "' requer P" << (mode == "par" ? " e IPC" : "")
+                  << " (ou um perfil paralelo gerado por 'primecount tune')." << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (profile != nullptr) {
+        // Chaves do perfil que --emit ou --cache não aceitam ficam no padrão:
+        // --emit só enumera com basic/sieve/mr em fatias estáticas de
+        // processos, e o --cache é ignorado com lmo
+        bool emit = !emit_path.empty();
+        bool algo_fits = !(emit && (profile->algo == "lmo" || profile->algo == "simd")) &&
+                         !(!cache_path.empty() && profile->algo == "lmo");
+        if (!algo_given && algo_fits) opts.algo = profile->algo;
+        if (!segment_given) sieve_segment_bytes = profile->segment;
+        if (mode != "seq" && !sched_given && opts.chunk == 0 && !emit) {
+            opts.sched = profile->sched;
+            opts.blocks_per_worker = profile->blocks;
+        }
+        if (from_profile) {
+            // 'par N' segue o perfil inteiro (inclusive trocar de modo, se o
+            // melhor foi seq ou threads); 'par-threads N' só adota o P
+            P = profile->P;
+            if (mode == "par" && profile->ipc == "none") {
+                mode = "seq";
+            } else if (mode == "par" && emit) {
+                ipc = "shm"; // Os anéis do --emit já são memória compartilhada
+            } else if (mode == "par" && profile->ipc == "threads") {
+                mode = "par-threads";
+            } else if (mode == "par") {
+                ipc = profile->ipc;
+            }
+        }
+        std::cerr << "perfil: " << profile_path << " (n=" << profile->n << ")" << std::endl;
+    }
+    if (!is_valid_algo(opts.algo)) {
+        std::cerr << "Erro: algo deve ser 'basic', 'sieve', 'mr', 'lmo' ou 'simd'." << std::endl;
+        return 1;
+    }
+    if (from > N) {
+        std::cerr << "Erro: from deve ser <= N." << std::endl;
+        return 1;
+    }
+    if (!is_valid_sched(opts.sched)) {
+        std::cerr << "Erro: sched deve ser 'static', 'dynamic' ou 'guided'." << std::endl;
+        return 1;
+    }
+    if (opts.progress && ipc != "futex" && ipc != "eventfd") {
+        std::cerr << "Erro: --progress requer o modo 'par' com IPC 'futex' ou 'eventfd'." << std::endl;
+        return 1;
+    }
+    if (hugepage_policy != "off" && hugepage_policy != "thp" && hugepage_policy != "explicit") {
+        std::cerr << "Erro: hugepages deve ser 'off', 'thp' ou 'explicit'." << std::endl;
+        return 1;
+    }
+    if (!opts.pin.empty() && !plan_affinity(opts.pin, std::max(P, 1), opts.pin_cpus)) {
+        std::cerr << "Erro: pin deve ser 'compact', 'scatter' ou uma lista de CPUs permitidas (ex.: 0,2,4-7)." << std::endl;
+        return 1;
+    }
+    if (!emit_path.empty()) {
+        // No modo 'par' os primos trafegam pelos anéis em memória compartilhada:
+        // só o IPC 'shm' descreve o que de fato acontece
+        if (mode == "par-threads" || (mode == "par" && ipc != "shm") || opts.algo == "lmo" ||
+            opts.algo == "simd" || !cache_path.empty() || opts.sched != "static") {
+            std::cerr << "Erro: --emit aceita apenas os modos 'seq' e 'par' (IPC 'shm'), com sched 'static', "
+                      << "sem --cache e algo 'basic', 'sieve' ou 'mr'." << std::endl;
+            return 1;
+        }
+        if (emit_format != "text" && emit_format != "binary") {
+            std::cerr << "Erro: emit-format deve ser 'text' ou 'binary'." << std::endl;
+            return 1;
+        }
+    }
+
     // ---------------------------------------------------------
     // Execução e Medição de Tempo
     // ---------------------------------------------------------
@@ -335,10 +4438,12 @@ int main(int argc, char* argv[]) {
     long long primes = 0;
     
     // Decide qual função executar com base no modo
-    if (mode == "seq") {
-        primes = run_sequential(N);
+    if (!emit_path.empty()) {
+        primes = run_emit(mode, from, N, P, opts, emit_path, emit_format == "binary");
+    } else if (!cache_path.empty()) {
+        primes = run_mode_cached(cache_path, mode, from, N, P, ipc, opts);
     } else {
-        primes = run_concurrent(N, P, ipc);
+        primes = run_mode(mode, from, N, P, ipc, opts);
     }
 
     // Captura tempo final e calcula a diferença em milissegundos
@@ -350,10 +4455,28 @@ int main(int argc, char* argv[]) {
     // ---------------------------------------------------------
     std::cout << "mode=" << mode 
               << " N=" << N;
+    if (from != 2) {
+        std::cout << " from=" << from;
+    }
     
     if (mode == "par") {
         std::cout << " P=" << P 
                   << " ipc=" << ipc;
+        if (opts.sched != "static") {
+            std::cout << " sched=" << opts.sched;
+        }
+    } else if (mode == "par-threads") {
+        std::cout << " P=" << P;
+    }
+    if (!opts.pin.empty()) {
+        std::cout << " pin=" << (opts.pin == "compact" || opts.pin == "scatter" ? opts.pin : "list")
+                  << " cpus=";
+        for (size_t k = 0; k < opts.pin_cpus.size(); k++) {
+            std::cout << (k > 0 ? "," : "") << opts.pin_cpus[k];
+        }
+    }
+    if (hugepage_policy != "off") {
+        std::cout << " hugepages=" << hugepage_policy;
     }
     
     std::cout << " primes=" << primes 
@@ -5,140 +5,2247 @@
  * Aluno: 20230012814
  *
  * Compilar: gcc -o cinema cinema.c -lpthread
- * Executar: ./cinema
+ * Executar: ./cinema [--engine E] [--fileiras F] [--assentos S]
+ *                    [--clientes C] [--grupo K | --grupo A-B] [--latencia US]
+ * Benchmark: ./cinema --bench [--engine E|todas] [--duracao S]
+ *                    [--cancelar P] [--pensar US] [demais opções acima]
+ * Pool:      --pool [--workers W] [--fila N] [--em-voo M] (nos dois modos)
+ * Roteamento: --rota aleatoria|p2c|menos-cheia (nos dois modos)
+ * Multiprocesso: ./cinema --sala ARQUIVO [...] (engine mutex)
+ *
+ * Engines (E): mutex, global, rwlock, spin, lockfree
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+/* Anel de log maior: um worker do pool registra um lote inteiro de */
+/* clientes de uma vez                                               */
+#define LOG_CAPACIDADE_ANEL 8192
+#include "../log_assincrono.h"
+
+
+/* Dimensões padrão (as do enunciado); podem ser trocadas na linha de comando */
+#define FILEIRAS 5
+#define ASSENTOS_POR_FILEIRA 10
+#define NUM_CLIENTES 20
+
+/* Maior grupo aceito: um grupo cabe em no máximo duas palavras do bitmap */
+#define GRUPO_MAXIMO 64
+
+typedef struct {
+  int fileiras;
+  int assentos_por_fileira;
+  int *assentos; /* fileiras × assentos_por_fileira; 0 = livre */
+} Sala;
+
+Sala sala;
+
+/* Assento j da fileira i */
+#define ASSENTO(i, j) sala.assentos[(size_t)(i) * sala.assentos_por_fileira + (j)]
+
+/* Cliente: identificador e tamanho do grupo que quer sentar junto */
+typedef struct {
+  int id;
+  int grupo;
+} Cliente;
+
+/* Estratégias de trava para as engines baseadas em lock */
+typedef enum {
+  TRAVA_MUTEX,  /* Um mutex por fileira (original) */
+  TRAVA_GLOBAL, /* Um único mutex para a sala toda */
+  TRAVA_RWLOCK, /* rwlock por fileira: busca com leitura, reserva com escrita */
+  TRAVA_SPIN    /* Spinlock por fileira */
+} Trava;
+
+Trava estrategia = TRAVA_MUTEX;
+
+/* Mutex por fileira — protege cada fileira individualmente */
+pthread_mutex_t *mutex_fileira;
+pthread_rwlock_t *rwlock_fileira;
+pthread_spinlock_t *spin_fileira;
+pthread_mutex_t mutex_global;
+
+/* Contadores de estatísticas em fatias: cada thread soma na sua, numa */
+/* linha de cache só dela, e a leitura junta todas. Com mais threads   */
+/* que fatias, algumas dividem uma fatia (os incrementos são atômicos).*/
+#define FATIAS_ESTATISTICAS 64
+
+typedef struct {
+  _Alignas(64) atomic_llong reservas_sucesso;
+  atomic_llong reservas_falha;
+  atomic_llong assentos_reservados; /* Soma dos grupos atendidos */
+} FatiaEstatisticas;
+
+FatiaEstatisticas fatias[FATIAS_ESTATISTICAS];
+
+/* Totais somados das fatias */
+typedef struct {
+  long long reservas_sucesso, reservas_falha, assentos_reservados;
+} Estatisticas;
+
+/* Latência de processamento simulada dentro da reserva, em µs (0 = sem) */
+int latencia_max_us = 1000;
+
+/* Resumo de uma faixa de assentos, nó da árvore de segmentos da fileira: */
+/* maior sequência livre no início (prefixo), no fim (sufixo) e em        */
+/* qualquer ponto (melhor).                                               */
+typedef struct {
+  int prefixo, sufixo, melhor, tamanho;
+} NoFaixa;
+
+/* Engines com lock: uma árvore de segmentos por fileira, protegida pela  */
+/* trava da fileira. Folhas em [folhas, 2 * folhas); as que sobram além  */
+/* do último assento contam como ocupadas.                                */
+NoFaixa *arvore;
+int folhas;
+
+/* Engine lock-free: cada fileira é um bitmap de palavras atômicas de 64  */
+/* bits (bit 1 = ocupado). O dono de cada assento continua em            */
+/* sala.assentos, escrito só por quem ganhou o CAS.                       */
+_Atomic uint64_t *mapa_bits;
+int palavras_por_fileira;
+
+/* Dicas de ocupação por fileira, lidas sem trava pelo roteamento:      */
+/* assentos livres e maior sequência livre. Quem altera a fileira       */
+/* publica os novos valores; um leitor pode ver um valor levemente      */
+/* atrasado, o que só custa uma tentativa a mais.                       */
+typedef struct {
+  _Alignas(64) atomic_int livres;
+  atomic_int maior_sequencia;
+} DicaFileira;
+
+DicaFileira *dicas;
+
+/* Política de escolha de fileira (--rota) */
+typedef enum {
+  ROTA_ALEATORIA,  /* Todas as fileiras em ordem aleatória (original) */
+  ROTA_P2C,        /* Duas fileiras sorteadas; fica a mais livre que caiba */
+  ROTA_MENOS_CHEIA /* A fileira com mais assentos livres que caiba */
+} Rota;
+
+Rota rota = ROTA_ALEATORIA;
+
+int tentar_reserva_lockfree(int cliente_id, int fileira, int k);
+
+/* Engine de reserva escolhida na inicialização (--engine). reservar      */
+/* devolve o primeiro assento do grupo ou -1; cancelar libera o grupo.    */
+int (*reservar)(int cliente_id, int fileira, int k);
+void (*cancelar)(int fileira, int inicio, int k);
+
+/* ------------------------------------------------------------------ */
+/* aleatorio: gerador xorshift64* com estado por thread. Substitui    */
+/* rand(), cujo estado global compartilhado serializa os clientes.    */
+/* ------------------------------------------------------------------ */
+static _Thread_local uint64_t estado_aleatorio = 88172645463325252ULL;
+
+static void semear_aleatorio(uint64_t semente) {
+  estado_aleatorio = (semente + 1) * 0x9E3779B97F4A7C15ULL | 1;
+}
+
+static uint32_t aleatorio(void) {
+  uint64_t x = estado_aleatorio;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  estado_aleatorio = x;
+  return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/* agora_ns: relógio monotônico em nanossegundos */
+static uint64_t agora_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/* ------------------------------------------------------------------ */
+/* simular_latencia: atraso de processamento opcional (--latencia).   */
+/* ------------------------------------------------------------------ */
+static void simular_latencia(void) {
+  if (latencia_max_us > 0) {
+    usleep(aleatorio() % latencia_max_us);
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* juntar: resumo de duas faixas vizinhas (esquerda, direita).        */
+/* ------------------------------------------------------------------ */
+static NoFaixa juntar(NoFaixa e, NoFaixa d) {
+  NoFaixa r;
+  r.tamanho = e.tamanho + d.tamanho;
+  r.prefixo = e.prefixo == e.tamanho ? e.tamanho + d.prefixo : e.prefixo;
+  r.sufixo = d.sufixo == d.tamanho ? d.tamanho + e.sufixo : d.sufixo;
+  r.melhor = e.sufixo + d.prefixo;
+  if (e.melhor > r.melhor) r.melhor = e.melhor;
+  if (d.melhor > r.melhor) r.melhor = d.melhor;
+  return r;
+}
+
+/* ------------------------------------------------------------------ */
+/* marcar_assento: atualiza a folha do assento j e sobe recalculando  */
+/* os ancestrais — O(log assentos). Chamar com a trava da fileira.    */
+/* ------------------------------------------------------------------ */
+static void marcar_assento(int fileira, int j, int livre) {
+  NoFaixa *arv = arvore + (size_t)fileira * 2 * folhas;
+  int no = folhas + j;
+  arv[no].prefixo = arv[no].sufixo = arv[no].melhor = livre;
+  for (no /= 2; no >= 1; no /= 2) {
+    arv[no] = juntar(arv[2 * no], arv[2 * no + 1]);
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* buscar_sequencia: primeiro assento da sequência livre mais à       */
+/* esquerda com pelo menos k lugares, ou -1. Rejeita em O(1) pela     */
+/* raiz e, se couber, desce a árvore em O(log assentos).              */
+/* ------------------------------------------------------------------ */
+static int buscar_sequencia(int fileira, int k) {
+  NoFaixa *arv = arvore + (size_t)fileira * 2 * folhas;
+  if (arv[1].melhor < k) {
+    return -1; /* Fileira cheia ou sem sequência longa o bastante */
+  }
+  int no = 1, inicio = 0;
+  while (no < folhas) {
+    int metade = arv[no].tamanho / 2;
+    NoFaixa e = arv[2 * no], d = arv[2 * no + 1];
+    if (e.melhor >= k) {
+      no = 2 * no;
+    } else if (e.sufixo + d.prefixo >= k) {
+      return inicio + metade - e.sufixo; /* Sequência cruza o meio */
+    } else {
+      no = 2 * no + 1;
+      inicio += metade;
+    }
+  }
+  return inicio;
+}
+
+/* ================================================================== */
+/* SALA COMPARTILHADA: estado num arquivo mapeado entre processos     */
+/* ================================================================== */
+
+/* Com --sala ARQUIVO, assentos, árvores, bitmaps, dicas e mutexes das  */
+/* fileiras ficam num arquivo mapeado com MAP_SHARED. Vários processos  */
+/* independentes reservam na mesma sala. Os mutexes são                */
+/* PTHREAD_PROCESS_SHARED e PTHREAD_MUTEX_ROBUST: se o dono morre com a */
+/* trava, o próximo a travar recebe EOWNERDEAD e recupera a fileira.    */
+/* A engine lockfree não tem essa recuperação (um processo que morre    */
+/* entre o CAS e a gravação do dono perderia assentos para sempre),     */
+/* então a sala compartilhada só aceita a engine mutex.                 */
+#define SALA_MAGICA "CINEMA01"
+#define SALA_VERSAO 2
+
+typedef enum {
+  INTENCAO_NENHUMA,
+  INTENCAO_RESERVA,
+  INTENCAO_CANCELAMENTO
+} TipoIntencao;
+
+/* Operação em andamento numa fileira, gravada antes de mexer nos     */
+/* assentos. Na recuperação, uma reserva pela metade é desfeita e um   */
+/* cancelamento pela metade é concluído.                               */
+typedef struct {
+  int tipo;
+  int cliente_id, inicio, k;
+} Intencao;
+
+typedef struct {
+  char magica[8];
+  int versao;
+  int fileiras, assentos_por_fileira;
+  uint64_t tamanho;
+  atomic_int pronta;
+  atomic_int proximo_cliente; /* Base de IDs, única entre processos */
+  atomic_llong reservas_sucesso, reservas_falha, assentos_reservados;
+} CabecalhoSala;
+
+CabecalhoSala *cabecalho; /* NULL = sala privada do processo */
+Intencao *intencoes;
+
+/* Deslocamentos de cada região no arquivo, alinhados a 64 bytes */
+typedef struct {
+  size_t mutexes, intencoes, dicas, arvore, bits, assentos, total;
+} LayoutSala;
+
+static size_t alinhar64(size_t x) { return (x + 63) & ~(size_t)63; }
+
+static LayoutSala calcular_layout(int fileiras, int assentos_por_fileira) {
+  size_t nos = 1, palavras = (assentos_por_fileira + 63) / 64;
+  while (nos < (size_t)assentos_por_fileira) {
+    nos *= 2;
+  }
+  LayoutSala l;
+  size_t pos = alinhar64(sizeof(CabecalhoSala));
+  l.mutexes = pos;
+  pos = alinhar64(pos + fileiras * sizeof(pthread_mutex_t));
+  l.intencoes = pos;
+  pos = alinhar64(pos + fileiras * sizeof(Intencao));
+  l.dicas = pos;
+  pos = alinhar64(pos + fileiras * sizeof(DicaFileira));
+  l.arvore = pos;
+  pos = alinhar64(pos + fileiras * 2 * nos * sizeof(NoFaixa));
+  l.bits = pos;
+  pos = alinhar64(pos + fileiras * palavras * sizeof(_Atomic uint64_t));
+  l.assentos = pos;
+  pos = alinhar64(pos + (size_t)fileiras * assentos_por_fileira * sizeof(int));
+  l.total = pos;
+  return l;
+}
+
+/* ------------------------------------------------------------------ */
+/* reconstruir_fileira: refaz a árvore de segmentos e as dicas da     */
+/* fileira a partir de sala.assentos (inicialização e recuperação).   */
+/* ------------------------------------------------------------------ */
+static void reconstruir_fileira(int fileira) {
+  NoFaixa *arv = arvore + (size_t)fileira * 2 * folhas;
+  int livres = 0;
+  for (int j = 0; j < folhas; j++) {
+    int livre = j < sala.assentos_por_fileira && ASSENTO(fileira, j) == 0;
+    arv[folhas + j] = (NoFaixa){livre, livre, livre, 1};
+    livres += livre;
+  }
+  for (int no = folhas - 1; no >= 1; no--) {
+    arv[no] = juntar(arv[2 * no], arv[2 * no + 1]);
+  }
+  atomic_store(&dicas[fileira].livres, livres);
+  atomic_store(&dicas[fileira].maior_sequencia, arv[1].melhor);
+}
+
+/* ------------------------------------------------------------------ */
+/* recuperar_fileira: chamada ao travar uma fileira cujo dono morreu  */
+/* (EOWNERDEAD). Usa a intenção gravada para desfazer a reserva ou    */
+/* concluir o cancelamento interrompido e reconstrói a fileira.       */
+/* ------------------------------------------------------------------ */
+static void recuperar_fileira(int fileira) {
+  Intencao *in = &intencoes[fileira];
+  int desfeitos = 0;
+  for (int a = in->inicio; in->tipo != INTENCAO_NENHUMA && a < in->inicio + in->k;
+       a++) {
+    if (in->tipo == INTENCAO_CANCELAMENTO || ASSENTO(fileira, a) == in->cliente_id) {
+      desfeitos += ASSENTO(fileira, a) != 0;
+      ASSENTO(fileira, a) = 0;
+    }
+  }
+  fprintf(stderr,
+          "Aviso: o processo que travava a fileira %d morreu; fileira "
+          "recuperada (%d assentos liberados)\n",
+          fileira + 1, desfeitos);
+  in->tipo = INTENCAO_NENHUMA;
+  reconstruir_fileira(fileira);
+}
+
+/* ------------------------------------------------------------------ */
+/* mapear_sala: abre (ou cria) o arquivo da sala e aponta as          */
+/* estruturas globais para dentro do mapeamento. A criação roda sob   */
+/* flock, e quem chega depois só valida o cabeçalho e anexa o estado  */
+/* existente, sem reconstruir nada. Uma sala existente impõe suas     */
+/* dimensões.                                                         */
+/* ------------------------------------------------------------------ */
+static void mapear_sala(const char *arquivo, int fileiras,
+                        int assentos_por_fileira) {
+  int fd = open(arquivo, O_RDWR | O_CREAT, 0644);
+  if (fd == -1 || flock(fd, LOCK_EX) == -1) {
+    perror("Erro ao abrir a sala compartilhada");
+    exit(1);
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    perror("Erro no fstat da sala compartilhada");
+    exit(1);
+  }
+  int criar = st.st_size == 0;
+  if (!criar) {
+    CabecalhoSala c;
+    if (pread(fd, &c, sizeof(c), 0) != (ssize_t)sizeof(c) ||
+        memcmp(c.magica, SALA_MAGICA, 8) != 0 || c.versao != SALA_VERSAO ||
+        c.tamanho != (uint64_t)st.st_size) {
+      fprintf(stderr, "Erro: '%s' não é uma sala válida\n", arquivo);
+      exit(1);
+    }
+    fileiras = c.fileiras;
+    assentos_por_fileira = c.assentos_por_fileira;
+  }
+
+  LayoutSala l = calcular_layout(fileiras, assentos_por_fileira);
+  if (criar && ftruncate(fd, (off_t)l.total) == -1) {
+    perror("Erro ao dimensionar a sala compartilhada");
+    exit(1);
+  }
+  char *base = mmap(NULL, l.total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    perror("Erro no mmap da sala compartilhada");
+    exit(1);
+  }
+
+  cabecalho = (CabecalhoSala *)base;
+  mutex_fileira = (pthread_mutex_t *)(base + l.mutexes);
+  intencoes = (Intencao *)(base + l.intencoes);
+  dicas = (DicaFileira *)(base + l.dicas);
+  arvore = (NoFaixa *)(base + l.arvore);
+  mapa_bits = (_Atomic uint64_t *)(base + l.bits);
+  sala.assentos = (int *)(base + l.assentos);
+  sala.fileiras = fileiras;
+  sala.assentos_por_fileira = assentos_por_fileira;
+  palavras_por_fileira = (assentos_por_fileira + 63) / 64;
+  folhas = 1;
+  while (folhas < assentos_por_fileira) {
+    folhas *= 2;
+  }
+
+  if (criar) {
+    /* ftruncate zerou tudo: assentos livres, bitmaps e intenções vazios */
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    for (int i = 0; i < fileiras; i++) {
+      pthread_mutex_init(&mutex_fileira[i], &attr);
+      reconstruir_fileira(i);
+    }
+    pthread_mutexattr_destroy(&attr);
+    memcpy(cabecalho->magica, SALA_MAGICA, 8);
+    cabecalho->versao = SALA_VERSAO;
+    cabecalho->fileiras = fileiras;
+    cabecalho->assentos_por_fileira = assentos_por_fileira;
+    cabecalho->tamanho = l.total;
+    atomic_store(&cabecalho->pronta, 1);
+  } else if (!atomic_load(&cabecalho->pronta)) {
+    fprintf(stderr, "Erro: a criação de '%s' foi interrompida; apague o arquivo\n",
+            arquivo);
+    exit(1);
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+/* ------------------------------------------------------------------ */
+/* inicializar_sala: aloca e zera assentos, árvores, bitmaps, travas  */
+/* e contadores para as dimensões pedidas. Com 'arquivo' != NULL, o   */
+/* estado vem da sala compartilhada (que pode impor outras dimensões).*/
+/* ------------------------------------------------------------------ */
+void inicializar_sala(int fileiras, int assentos_por_fileira, const char *arquivo) {
+  if (arquivo != NULL) {
+    mapear_sala(arquivo, fileiras, assentos_por_fileira);
+    fileiras = sala.fileiras;
+  } else {
+    sala.fileiras = fileiras;
+    sala.assentos_por_fileira = assentos_por_fileira;
+    sala.assentos = calloc((size_t)fileiras * assentos_por_fileira, sizeof(int));
+
+    folhas = 1;
+    while (folhas < assentos_por_fileira) {
+      folhas *= 2;
+    }
+    arvore = calloc((size_t)fileiras * 2 * folhas, sizeof(NoFaixa));
+    palavras_por_fileira = (assentos_por_fileira + 63) / 64;
+    mapa_bits = malloc((size_t)fileiras * palavras_por_fileira *
+                       sizeof(_Atomic uint64_t));
+    dicas = aligned_alloc(64, fileiras * sizeof(DicaFileira));
+    mutex_fileira = malloc(fileiras * sizeof(pthread_mutex_t));
+    if (sala.assentos == NULL || arvore == NULL || mapa_bits == NULL ||
+        dicas == NULL || mutex_fileira == NULL) {
+      perror("Erro ao alocar a sala");
+      exit(1);
+    }
+    for (int w = 0; w < fileiras * palavras_por_fileira; w++) {
+      atomic_init(&mapa_bits[w], 0);
+    }
+    for (int i = 0; i < fileiras; i++) {
+      pthread_mutex_init(&mutex_fileira[i], NULL);
+      reconstruir_fileira(i);
+    }
+  }
+
+  rwlock_fileira = malloc(fileiras * sizeof(pthread_rwlock_t));
+  spin_fileira = malloc(fileiras * sizeof(pthread_spinlock_t));
+  if (rwlock_fileira == NULL || spin_fileira == NULL) {
+    perror("Erro ao alocar as travas");
+    exit(1);
+  }
+  for (int i = 0; i < fileiras; i++) {
+    pthread_rwlock_init(&rwlock_fileira[i], NULL);
+    pthread_spin_init(&spin_fileira[i], PTHREAD_PROCESS_PRIVATE);
+  }
+  pthread_mutex_init(&mutex_global, NULL);
+
+  for (int f = 0; f < FATIAS_ESTATISTICAS; f++) {
+    atomic_store(&fatias[f].reservas_sucesso, 0);
+    atomic_store(&fatias[f].reservas_falha, 0);
+    atomic_store(&fatias[f].assentos_reservados, 0);
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* destruir_sala: destrói as travas e libera tudo o que               */
+/* inicializar_sala alocou. A sala compartilhada só é desmapeada: o   */
+/* estado continua no arquivo para os outros processos.               */
+/* ------------------------------------------------------------------ */
+void destruir_sala() {
+  for (int i = 0; i < sala.fileiras; i++) {
+    pthread_rwlock_destroy(&rwlock_fileira[i]);
+    pthread_spin_destroy(&spin_fileira[i]);
+  }
+  pthread_mutex_destroy(&mutex_global);
+  free(rwlock_fileira);
+  free((void *)spin_fileira);
+  if (cabecalho != NULL) {
+    munmap(cabecalho, cabecalho->tamanho);
+    cabecalho = NULL;
+    intencoes = NULL;
+    return;
+  }
+  for (int i = 0; i < sala.fileiras; i++) {
+    pthread_mutex_destroy(&mutex_fileira[i]);
+  }
+  free(mutex_fileira);
+  free(sala.assentos);
+  free(arvore);
+  free(mapa_bits);
+  free(dicas);
+}
+
+/* ================================================================== */
+/* DIÁRIO: journal de reservas com group commit                       */
+/* ================================================================== */
+
+/* Com --diario ARQUIVO, cada reserva e cada cancelamento viram um      */
+/* registro de 32 bytes num arquivo só de acréscimo. Um fdatasync por   */
+/* reserva derrubaria a vazão, então uma thread dedicada (flusher)      */
+/* junta tudo o que chega dentro da janela (--janela US) ou até o       */
+/* orçamento de bytes (--lote-bytes B) num único write + fdatasync. Só  */
+/* depois o cliente recebe a confirmação. A cada --snapshot N registros,*/
+/* o flusher grava uma foto da sala (ARQUIVO.snap) e esvazia o diário.  */
+/* Na partida, a sala é refeita a partir do snapshot mais o diário.     */
+#define REGISTRO_RESERVA 1
+#define REGISTRO_CANCELAMENTO 2
+#define SNAPSHOT_MAGICA "CINSNAP1"
+
+typedef struct {
+  uint64_t lsn; /* Número de sequência, crescente */
+  uint32_t tipo;
+  int32_t fileira, inicio, k, cliente_id;
+  uint32_t soma; /* FNV-1a dos campos anteriores: detecta cauda rasgada */
+} RegistroDiario;
+
+typedef struct {
+  char magica[8];
+  int32_t fileiras, assentos_por_fileira;
+  uint64_t lsn; /* Último registro incluído na foto */
+} CabecalhoSnapshot;
+
+typedef struct {
+  int fd;
+  char caminho[4096], caminho_snapshot[4112];
+  pthread_mutex_t mutex;
+  pthread_cond_t ha_registros, duravel;
+  RegistroDiario *ativo, *gravando; /* Buffer que recebe / que vai ao disco */
+  size_t usados, capacidade_ativo, capacidade_gravando;
+  uint64_t proximo_lsn, lsn_duravel;
+  int encerrar;
+  int janela_us;
+  size_t lote_bytes;
+  int snapshot_a_cada;
+  pthread_t flusher;
+  int *sombra; /* Sala segundo o diário; só o flusher mexe */
+  int desde_snapshot;
+  uint64_t escritas, registros, snapshots; /* Estatísticas */
+} Diario;
+
+Diario diario;
+int diario_ativo;
+
+/* LSN do último registro anexado por esta thread, a confirmar */
+static _Thread_local uint64_t lsn_pendente;
+
+static uint32_t soma_registro(const RegistroDiario *r) {
+  const unsigned char *p = (const unsigned char *)r;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < offsetof(RegistroDiario, soma); i++) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return h;
+}
+
+/* ------------------------------------------------------------------ */
+/* aplicar_registro: efeito de um registro num mapa de assentos.      */
+/* Retorna 0 se o registro não cabe nas dimensões da sala.            */
+/* ------------------------------------------------------------------ */
+static int aplicar_registro(int *mapa, const RegistroDiario *r) {
+  if (r->fileira < 0 || r->fileira >= sala.fileiras || r->inicio < 0 ||
+      r->k < 1 || r->inicio + r->k > sala.assentos_por_fileira) {
+    return 0;
+  }
+  int *linha = mapa + (size_t)r->fileira * sala.assentos_por_fileira;
+  for (int a = r->inicio; a < r->inicio + r->k; a++) {
+    linha[a] = r->tipo == REGISTRO_RESERVA ? r->cliente_id : 0;
+  }
+  return 1;
+}
+
+/* ------------------------------------------------------------------ */
+/* gravar_tudo: write até o fim (write pode gravar menos que o pedido)*/
+/* ------------------------------------------------------------------ */
+static void gravar_tudo(int fd, const void *dados, size_t tamanho) {
+  const char *p = dados;
+  while (tamanho > 0) {
+    ssize_t n = write(fd, p, tamanho);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) {
+      perror("Erro ao gravar o diário");
+      exit(1);
+    }
+    p += n;
+    tamanho -= (size_t)n;
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* gravar_snapshot: foto da sombra em ARQUIVO.snap (via arquivo       */
+/* temporário + rename, atômico) e esvazia o diário, cujos registros  */
+/* já estão todos na foto. Roda no flusher, entre dois lotes.         */
+/* ------------------------------------------------------------------ */
+static void gravar_snapshot(uint64_t lsn) {
+  char temporario[4120];
+  snprintf(temporario, sizeof(temporario), "%s.tmp", diario.caminho_snapshot);
+  int fd = open(temporario, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    perror("Erro ao criar o snapshot");
+    exit(1);
+  }
+  CabecalhoSnapshot c;
+  memcpy(c.magica, SNAPSHOT_MAGICA, 8);
+  c.fileiras = sala.fileiras;
+  c.assentos_por_fileira = sala.assentos_por_fileira;
+  c.lsn = lsn;
+  gravar_tudo(fd, &c, sizeof(c));
+  gravar_tudo(fd, diario.sombra,
+              (size_t)sala.fileiras * sala.assentos_por_fileira * sizeof(int));
+  if (fdatasync(fd) == -1 || close(fd) == -1 ||
+      rename(temporario, diario.caminho_snapshot) == -1) {
+    perror("Erro ao gravar o snapshot");
+    exit(1);
+  }
+  /* O rename só é durável com o fsync do diretório; antes disso, */
+  /* esvaziar o diário poderia perder reservas confirmadas        */
+  char diretorio[4112];
+  snprintf(diretorio, sizeof(diretorio), "%s", diario.caminho_snapshot);
+  char *barra = strrchr(diretorio, '/');
+  if (barra == NULL) {
+    strcpy(diretorio, ".");
+  } else {
+    barra[barra == diretorio] = '\0'; /* "/x.snap" -> "/" */
+  }
+  int fd_diretorio = open(diretorio, O_RDONLY | O_DIRECTORY);
+  if (fd_diretorio == -1 || fsync(fd_diretorio) == -1) {
+    perror("Erro ao sincronizar o diretório do snapshot");
+    exit(1);
+  }
+  close(fd_diretorio);
+  if (ftruncate(diario.fd, 0) == -1) {
+    perror("Erro ao esvaziar o diário");
+    exit(1);
+  }
+  diario.desde_snapshot = 0;
+  diario.snapshots++;
+}
+
+/* ------------------------------------------------------------------ */
+/* flusher: espera registros, deixa a janela de group commit correr   */
+/* (ou o lote encher), troca os buffers e grava o lote inteiro com um */
+/* write + fdatasync. Depois acorda todos os clientes do lote.        */
+/* ------------------------------------------------------------------ */
+void *flusher(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&diario.mutex);
+  for (;;) {
+    while (diario.usados == 0 && !diario.encerrar) {
+      pthread_cond_wait(&diario.ha_registros, &diario.mutex);
+    }
+    if (diario.usados == 0) {
+      break; /* Encerrando e nada pendente */
+    }
+
+    /* Janela de group commit, contada a partir do primeiro registro */
+    struct timespec prazo;
+    clock_gettime(CLOCK_REALTIME, &prazo);
+    prazo.tv_nsec += (long)diario.janela_us * 1000;
+    prazo.tv_sec += prazo.tv_nsec / 1000000000L;
+    prazo.tv_nsec %= 1000000000L;
+    while (diario.usados * sizeof(RegistroDiario) < diario.lote_bytes &&
+           !diario.encerrar &&
+           pthread_cond_timedwait(&diario.ha_registros, &diario.mutex,
+                                  &prazo) != ETIMEDOUT) {
+    }
+
+    /* O reserva vira o ativo; se o ativo cresceu, cresce junto antes */
+    /* que os produtores voltem a escrever nele                       */
+    if (diario.capacidade_gravando < diario.capacidade_ativo) {
+      RegistroDiario *maior = realloc(
+          diario.gravando, diario.capacidade_ativo * sizeof(RegistroDiario));
+      if (maior == NULL) {
+        perror("Erro ao alocar o buffer do diário");
+        exit(1);
+      }
+      diario.gravando = maior;
+      diario.capacidade_gravando = diario.capacidade_ativo;
+    }
+    RegistroDiario *lote = diario.ativo;
+    size_t n = diario.usados, capacidade_lote = diario.capacidade_ativo;
+    diario.ativo = diario.gravando;
+    diario.capacidade_ativo = diario.capacidade_gravando;
+    diario.gravando = lote;
+    diario.capacidade_gravando = capacidade_lote;
+    diario.usados = 0;
+    pthread_mutex_unlock(&diario.mutex);
+
+    gravar_tudo(diario.fd, lote, n * sizeof(RegistroDiario));
+    if (fdatasync(diario.fd) == -1) {
+      perror("Erro no fdatasync do diário");
+      exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+      aplicar_registro(diario.sombra, &lote[i]);
+    }
+    diario.desde_snapshot += (int)n;
+    if (diario.snapshot_a_cada > 0 &&
+        diario.desde_snapshot >= diario.snapshot_a_cada) {
+      gravar_snapshot(lote[n - 1].lsn);
+    }
+
+    pthread_mutex_lock(&diario.mutex);
+    diario.lsn_duravel = lote[n - 1].lsn;
+    diario.escritas++;
+    diario.registros += n;
+    pthread_cond_broadcast(&diario.duravel);
+  }
+  pthread_mutex_unlock(&diario.mutex);
+  return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/* diario_anexar: acrescenta um registro ao lote em formação e        */
+/* retorna seu LSN. As engines chamam dentro da trava da fileira (ou  */
+/* antes de devolver os bits, na lockfree), então a ordem do diário   */
+/* respeita a ordem das mudanças em cada assento.                     */
+/* ------------------------------------------------------------------ */
+static void diario_anexar(uint32_t tipo, int fileira, int inicio, int k,
+                          int cliente_id) {
+  pthread_mutex_lock(&diario.mutex);
+  if (diario.usados == diario.capacidade_ativo) {
+    diario.capacidade_ativo *= 2;
+    diario.ativo =
+        realloc(diario.ativo, diario.capacidade_ativo * sizeof(RegistroDiario));
+    if (diario.ativo == NULL) {
+      perror("Erro ao alocar o buffer do diário");
+      exit(1);
+    }
+  }
+  RegistroDiario *r = &diario.ativo[diario.usados++];
+  memset(r, 0, sizeof(*r));
+  r->lsn = ++diario.proximo_lsn;
+  r->tipo = tipo;
+  r->fileira = fileira;
+  r->inicio = inicio;
+  r->k = k;
+  r->cliente_id = cliente_id;
+  r->soma = soma_registro(r);
+  lsn_pendente = r->lsn;
+  if (diario.usados == 1 ||
+      diario.usados * sizeof(RegistroDiario) >= diario.lote_bytes) {
+    pthread_cond_signal(&diario.ha_registros);
+  }
+  pthread_mutex_unlock(&diario.mutex);
+}
+
+/* ------------------------------------------------------------------ */
+/* diario_confirmar: bloqueia até o último registro desta thread      */
+/* estar em disco. Os clientes chamam antes de considerar a operação  */
+/* confirmada, já fora de qualquer trava de fileira.                  */
+/* ------------------------------------------------------------------ */
+void diario_confirmar(void) {
+  if (!diario_ativo || lsn_pendente == 0) {
+    return;
+  }
+  pthread_mutex_lock(&diario.mutex);
+  while (diario.lsn_duravel < lsn_pendente) {
+    pthread_cond_wait(&diario.duravel, &diario.mutex);
+  }
+  pthread_mutex_unlock(&diario.mutex);
+  lsn_pendente = 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* diario_abrir: refaz a sala a partir do snapshot e do diário e      */
+/* inicia o flusher. Uma cauda rasgada (registro incompleto ou com    */
+/* soma errada, de uma queda no meio do write) é descartada. Retorna  */
+/* o maior ID de cliente encontrado. Usar após inicializar_sala.      */
+/* ------------------------------------------------------------------ */
+int diario_abrir(const char *caminho, int janela_us, size_t lote_bytes,
+                 int snapshot_a_cada) {
+  size_t total = (size_t)sala.fileiras * sala.assentos_por_fileira;
+  snprintf(diario.caminho, sizeof(diario.caminho), "%s", caminho);
+  snprintf(diario.caminho_snapshot, sizeof(diario.caminho_snapshot), "%s.snap",
+           caminho);
+  diario.janela_us = janela_us;
+  diario.lote_bytes = lote_bytes;
+  diario.snapshot_a_cada = snapshot_a_cada;
+  diario.sombra = calloc(total, sizeof(int));
+  if (diario.sombra == NULL) {
+    perror("Erro ao alocar a sombra do diário");
+    exit(1);
+  }
+
+  /* 1. Snapshot, se houver */
+  uint64_t lsn_base = 0;
+  int fd = open(diario.caminho_snapshot, O_RDONLY);
+  if (fd != -1) {
+    CabecalhoSnapshot c;
+    if (read(fd, &c, sizeof(c)) != (ssize_t)sizeof(c) ||
+        memcmp(c.magica, SNAPSHOT_MAGICA, 8) != 0 ||
+        c.fileiras != sala.fileiras ||
+        c.assentos_por_fileira != sala.assentos_por_fileira ||
+        read(fd, diario.sombra, total * sizeof(int)) !=
+            (ssize_t)(total * sizeof(int))) {
+      fprintf(stderr, "Erro: snapshot '%s' inválido ou de outra sala\n",
+              diario.caminho_snapshot);
+      exit(1);
+    }
+    lsn_base = c.lsn;
+    close(fd);
+  }
+
+  /* 2. Registros posteriores ao snapshot */
+  diario.fd = open(caminho, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (diario.fd == -1) {
+    perror("Erro ao abrir o diário");
+    exit(1);
+  }
+  RegistroDiario r;
+  uint64_t ultimo = lsn_base;
+  off_t valido = 0;
+  int reaplicados = 0;
+  while (pread(diario.fd, &r, sizeof(r), valido) == (ssize_t)sizeof(r) &&
+         r.soma == soma_registro(&r)) {
+    if (r.lsn > lsn_base) {
+      if (r.lsn != ultimo + 1 || !aplicar_registro(diario.sombra, &r)) {
+        break; /* Lacuna ou registro de outra sala: trata como cauda */
+      }
+      ultimo = r.lsn;
+      reaplicados++;
+    }
+    valido += sizeof(r);
+  }
+  if (ftruncate(diario.fd, valido) == -1) {
+    perror("Erro ao descartar a cauda do diário");
+    exit(1);
+  }
+
+  /* 3. Sala em memória = sombra; refaz árvores, bitmaps e dicas */
+  int maior_id = 0, ocupados = 0;
+  for (int i = 0; i < sala.fileiras; i++) {
+    for (int w = 0; w < palavras_por_fileira; w++) {
+      atomic_store(&mapa_bits[(size_t)i * palavras_por_fileira + w], 0);
+    }
+    for (int j = 0; j < sala.assentos_por_fileira; j++) {
+      int id = diario.sombra[(size_t)i * sala.assentos_por_fileira + j];
+      ASSENTO(i, j) = id;
+      if (id != 0) {
+        atomic_fetch_or(&mapa_bits[(size_t)i * palavras_por_fileira + j / 64],
+                        1ULL << (j % 64));
+        ocupados++;
+        if (id > maior_id) maior_id = id;
+      }
+    }
+    reconstruir_fileira(i);
+  }
+  if (lsn_base > 0 || reaplicados > 0) {
+    printf("Diário: snapshot até LSN %llu + %d registros reaplicados "
+           "(%d assentos ocupados)\n",
+           (unsigned long long)lsn_base, reaplicados, ocupados);
+  }
+
+  /* 4. Flusher */
+  pthread_mutex_init(&diario.mutex, NULL);
+  pthread_cond_init(&diario.ha_registros, NULL);
+  pthread_cond_init(&diario.duravel, NULL);
+  diario.capacidade_ativo = diario.capacidade_gravando = 1024;
+  diario.ativo = malloc(diario.capacidade_ativo * sizeof(RegistroDiario));
+  diario.gravando = malloc(diario.capacidade_gravando * sizeof(RegistroDiario));
+  if (diario.ativo == NULL || diario.gravando == NULL) {
+    perror("Erro ao alocar o buffer do diário");
+    exit(1);
+  }
+  diario.usados = 0;
+  diario.proximo_lsn = diario.lsn_duravel = ultimo;
+  diario.encerrar = 0;
+  diario.desde_snapshot = reaplicados;
+  diario.escritas = diario.registros = diario.snapshots = 0;
+  diario_ativo = 1;
+  pthread_create(&diario.flusher, NULL, flusher, NULL);
+  return maior_id;
+}
+
+/* ------------------------------------------------------------------ */
+/* diario_fechar: grava o que falta, encerra o flusher e libera tudo. */
+/* ------------------------------------------------------------------ */
+void diario_fechar(void) {
+  pthread_mutex_lock(&diario.mutex);
+  diario.encerrar = 1;
+  pthread_cond_signal(&diario.ha_registros);
+  pthread_mutex_unlock(&diario.mutex);
+  pthread_join(diario.flusher, NULL);
+  close(diario.fd);
+  pthread_mutex_destroy(&diario.mutex);
+  pthread_cond_destroy(&diario.ha_registros);
+  pthread_cond_destroy(&diario.duravel);
+  free(diario.ativo);
+  free(diario.gravando);
+  free(diario.sombra);
+  diario_ativo = 0;
+}
+
+/* ================================================================== */
+/* PERFIL DE TRAVAS (--perfil)                                         */
+/* ================================================================== */
+
+/* Com --perfil, travar/destravar medem, para cada fileira, quanto se  */
+/* esperou para obter a trava e quanto tempo ela ficou presa. Cada     */
+/* aquisição começa com um trylock: se falhar, a trava estava          */
+/* disputada. Sem --perfil, o custo é um teste de ponteiro NULL.       */
+/* Os histogramas são por potência de 2 (64 faixas), pequenos o        */
+/* bastante para existir um por fileira.                               */
+#define PERFIL_FAIXAS 64
+
+typedef struct {
+  _Alignas(64) atomic_ullong aquisicoes;
+  atomic_ullong contendidas; /* trylock falhou: houve espera */
+  atomic_ullong rejeicoes;   /* Travou e o grupo não coube */
+  atomic_ullong espera_ns, posse_ns;
+  atomic_ullong espera[PERFIL_FAIXAS], posse[PERFIL_FAIXAS];
+} PerfilTrava;
+
+PerfilTrava *perfil; /* Um por fileira; NULL = perfil desligado */
+
+/* Instante em que esta thread obteve a trava que segura agora */
+static _Thread_local uint64_t posse_desde;
+
+static void perfil_iniciar(int fileiras) {
+  perfil = aligned_alloc(64, fileiras * sizeof(PerfilTrava));
+  if (perfil == NULL) {
+    perror("Erro ao alocar o perfil de travas");
+    exit(1);
+  }
+  memset(perfil, 0, fileiras * sizeof(PerfilTrava));
+}
+
+static void perfil_encerrar(void) {
+  free(perfil);
+  perfil = NULL;
+}
+
+static void perfil_registrar(atomic_ullong *faixas, atomic_ullong *soma,
+                             uint64_t ns) {
+  int f = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+  atomic_fetch_add_explicit(&faixas[f], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(soma, ns, memory_order_relaxed);
+}
+
+/* Percentil p (0..1) de um histograma do perfil; devolve o limite */
+/* superior da faixa, em ns                                         */
+static uint64_t perfil_percentil(const uint64_t *faixas, double p) {
+  uint64_t total = 0, acumulado = 0;
+  for (int f = 0; f < PERFIL_FAIXAS; f++) {
+    total += faixas[f];
+  }
+  for (int f = 0; f < PERFIL_FAIXAS; f++) {
+    acumulado += faixas[f];
+    if (acumulado > (uint64_t)(p * total)) {
+      return f == 63 ? UINT64_MAX : (2ULL << f) - 1;
+    }
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* imprimir_perfil: totais da sala e as fileiras mais quentes (maior  */
+/* tempo total de espera).                                            */
+/* ------------------------------------------------------------------ */
+#define PERFIL_TOP 5
+
+void imprimir_perfil(const char *prefixo) {
+  uint64_t aquisicoes = 0, contendidas = 0, rejeicoes = 0;
+  uint64_t espera[PERFIL_FAIXAS] = {0}, posse[PERFIL_FAIXAS] = {0};
+  int top[PERFIL_TOP], num_top = 0;
+  for (int i = 0; i < sala.fileiras; i++) {
+    PerfilTrava *p = &perfil[i];
+    aquisicoes += atomic_load(&p->aquisicoes);
+    contendidas += atomic_load(&p->contendidas);
+    rejeicoes += atomic_load(&p->rejeicoes);
+    for (int f = 0; f < PERFIL_FAIXAS; f++) {
+      espera[f] += atomic_load(&p->espera[f]);
+      posse[f] += atomic_load(&p->posse[f]);
+    }
+    /* Inserção ordenada nas PERFIL_TOP fileiras de maior espera */
+    int pos = num_top < PERFIL_TOP ? num_top++ : PERFIL_TOP;
+    while (pos > 0 && atomic_load(&perfil[top[pos - 1]].espera_ns) <
+                          atomic_load(&p->espera_ns)) {
+      if (pos < PERFIL_TOP) top[pos] = top[pos - 1];
+      pos--;
+    }
+    if (pos < PERFIL_TOP) top[pos] = i;
+  }
+  if (aquisicoes == 0) {
+    printf("%sPerfil: nenhuma trava adquirida\n", prefixo);
+    return;
+  }
+  printf("%sPerfil: %llu aquisições, %.1f%% disputadas, %llu rejeições | "
+         "espera p50/p99 %.1f/%.1f µs | posse p50/p99 %.1f/%.1f µs\n",
+         prefixo, (unsigned long long)aquisicoes, 100.0 * contendidas / aquisicoes,
+         (unsigned long long)rejeicoes, perfil_percentil(espera, 0.50) / 1e3,
+         perfil_percentil(espera, 0.99) / 1e3, perfil_percentil(posse, 0.50) / 1e3,
+         perfil_percentil(posse, 0.99) / 1e3);
+  if (estrategia == TRAVA_GLOBAL) {
+    printf("%s  (trava global: as fileiras abaixo disputam o mesmo mutex)\n",
+           prefixo);
+  }
+  printf("%s  %-8s %11s %9s %12s %12s %12s %12s\n", prefixo, "fileira",
+         "aquisicoes", "disput%", "espera_med", "espera_p99", "posse_med",
+         "posse_p99");
+  for (int t = 0; t < num_top; t++) {
+    PerfilTrava *p = &perfil[top[t]];
+    uint64_t n = atomic_load(&p->aquisicoes);
+    if (n == 0) {
+      break;
+    }
+    uint64_t faixas_espera[PERFIL_FAIXAS], faixas_posse[PERFIL_FAIXAS];
+    for (int f = 0; f < PERFIL_FAIXAS; f++) {
+      faixas_espera[f] = atomic_load(&p->espera[f]);
+      faixas_posse[f] = atomic_load(&p->posse[f]);
+    }
+    printf("%s  %-8d %11llu %8.1f%% %9.1f µs %9.1f µs %9.1f µs %9.1f µs\n",
+           prefixo, top[t] + 1, (unsigned long long)n,
+           100.0 * atomic_load(&p->contendidas) / n,
+           atomic_load(&p->espera_ns) / 1e3 / n,
+           perfil_percentil(faixas_espera, 0.99) / 1e3,
+           atomic_load(&p->posse_ns) / 1e3 / n,
+           perfil_percentil(faixas_posse, 0.99) / 1e3);
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* adquirir / tentar_adquirir / liberar: seção crítica da fileira     */
+/* conforme a estratégia (no rwlock, 'escrita' escolhe entre trava    */
+/* exclusiva e de leitura). tentar_adquirir devolve 1 se travou.      */
+/* ------------------------------------------------------------------ */
+static void adquirir(int fileira, int escrita) {
+  switch (estrategia) {
+  case TRAVA_MUTEX:
+    /* Na sala compartilhada o mutex é robusto: EOWNERDEAD = o dono */
+    /* morreu com ele; recupera a fileira e marca o mutex consistente */
+    if (pthread_mutex_lock(&mutex_fileira[fileira]) == EOWNERDEAD) {
+      recuperar_fileira(fileira);
+      pthread_mutex_consistent(&mutex_fileira[fileira]);
+    }
+    break;
+  case TRAVA_GLOBAL:
+    pthread_mutex_lock(&mutex_global);
+    break;
+  case TRAVA_RWLOCK:
+    if (escrita) {
+      pthread_rwlock_wrlock(&rwlock_fileira[fileira]);
+    } else {
+      pthread_rwlock_rdlock(&rwlock_fileira[fileira]);
+    }
+    break;
+  case TRAVA_SPIN:
+    pthread_spin_lock(&spin_fileira[fileira]);
+    break;
+  }
+}
+
+static int tentar_adquirir(int fileira, int escrita) {
+  int r = 0;
+  switch (estrategia) {
+  case TRAVA_MUTEX:
+    r = pthread_mutex_trylock(&mutex_fileira[fileira]);
+    if (r == EOWNERDEAD) {
+      recuperar_fileira(fileira);
+      pthread_mutex_consistent(&mutex_fileira[fileira]);
+      r = 0;
+    }
+    break;
+  case TRAVA_GLOBAL:
+    r = pthread_mutex_trylock(&mutex_global);
+    break;
+  case TRAVA_RWLOCK:
+    r = escrita ? pthread_rwlock_trywrlock(&rwlock_fileira[fileira])
+                : pthread_rwlock_tryrdlock(&rwlock_fileira[fileira]);
+    break;
+  case TRAVA_SPIN:
+    r = pthread_spin_trylock(&spin_fileira[fileira]);
+    break;
+  }
+  return r == 0;
+}
+
+static void liberar(int fileira) {
+  switch (estrategia) {
+  case TRAVA_MUTEX:
+    pthread_mutex_unlock(&mutex_fileira[fileira]);
+    break;
+  case TRAVA_GLOBAL:
+    pthread_mutex_unlock(&mutex_global);
+    break;
+  case TRAVA_RWLOCK:
+    pthread_rwlock_unlock(&rwlock_fileira[fileira]);
+    break;
+  case TRAVA_SPIN:
+    pthread_spin_unlock(&spin_fileira[fileira]);
+    break;
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* travar / destravar: adquirir / liberar, medindo espera e posse     */
+/* quando o perfil está ligado.                                       */
+/* ------------------------------------------------------------------ */
+static void travar(int fileira, int escrita) {
+  if (perfil == NULL) {
+    adquirir(fileira, escrita);
+    return;
+  }
+  uint64_t t0 = agora_ns();
+  int disputada = !tentar_adquirir(fileira, escrita);
+  if (disputada) {
+    adquirir(fileira, escrita);
+  }
+  posse_desde = agora_ns();
+  PerfilTrava *p = &perfil[fileira];
+  atomic_fetch_add_explicit(&p->aquisicoes, 1, memory_order_relaxed);
+  if (disputada) {
+    atomic_fetch_add_explicit(&p->contendidas, 1, memory_order_relaxed);
+  }
+  perfil_registrar(p->espera, &p->espera_ns, posse_desde - t0);
+}
+
+static void destravar(int fileira) {
+  if (perfil != NULL) {
+    PerfilTrava *p = &perfil[fileira];
+    perfil_registrar(p->posse, &p->posse_ns, agora_ns() - posse_desde);
+  }
+  liberar(fileira);
+}
+
+/* ------------------------------------------------------------------ */
+/* publicar_dica_arvore: atualiza as dicas da fileira após reservar   */
+/* (delta < 0) ou cancelar (delta > 0). Chamar com a trava de escrita: */
+/* a raiz da árvore já traz a maior sequência livre.                  */
+/* ------------------------------------------------------------------ */
+static void publicar_dica_arvore(int fileira, int delta) {
+  NoFaixa *arv = arvore + (size_t)fileira * 2 * folhas;
+  atomic_fetch_add_explicit(&dicas[fileira].livres, delta, memory_order_relaxed);
+  atomic_store_explicit(&dicas[fileira].maior_sequencia, arv[1].melhor,
+                        memory_order_relaxed);
+}
+
+/* ------------------------------------------------------------------ */
+/* tentar_reserva: busca k assentos adjacentes livres na fileira.     */
+/* Retorna o primeiro assento reservado, ou -1 se não coube.          */
+/* SEÇÃO CRÍTICA: protegida pela trava da fileira (ou global).        */
+/* A busca usa a árvore de segmentos: O(log assentos), sem varredura. */
+/* No rwlock, a busca roda com trava de leitura, e a rejeição não     */
+/* bloqueia outros leitores. Se couber, troca para a trava de escrita */
+/* e busca de novo, pois a fileira pode ter mudado na troca.          */
+/* ------------------------------------------------------------------ */
+int tentar_reserva(int cliente_id, int fileira, int k) {
+  if (estrategia == TRAVA_RWLOCK) {
+    travar(fileira, 0);
+    int cabe = buscar_sequencia(fileira, k) >= 0;
+    destravar(fileira);
+    if (!cabe) {
+      if (perfil != NULL) {
+        atomic_fetch_add_explicit(&perfil[fileira].rejeicoes, 1,
+                                  memory_order_relaxed);
+      }
+      return -1;
+    }
+  }
+  travar(fileira, 1);
+
+  int j = buscar_sequencia(fileira, k);
+  if (j < 0) {
+    destravar(fileira);
+    if (perfil != NULL) {
+      atomic_fetch_add_explicit(&perfil[fileira].rejeicoes, 1,
+                                memory_order_relaxed);
+    }
+    return -1; /* Nenhuma sequência de k assentos nesta fileira */
+  }
+  if (intencoes != NULL) {
+    intencoes[fileira] = (Intencao){INTENCAO_RESERVA, cliente_id, j, k};
+  }
+
+  /* Simula latência de processamento */
+  simular_latencia();
+
+  /* Reserva os k assentos, marcando com o ID do cliente */
+  for (int a = j; a < j + k; a++) {
+    ASSENTO(fileira, a) = cliente_id;
+    marcar_assento(fileira, a, 0);
+  }
+  publicar_dica_arvore(fileira, -k);
+  if (diario_ativo) {
+    diario_anexar(REGISTRO_RESERVA, fileira, j, k, cliente_id);
+  }
+  if (intencoes != NULL) {
+    intencoes[fileira].tipo = INTENCAO_NENHUMA;
+  }
+
+  destravar(fileira);
+  return j; /* Reserva bem-sucedida */
+}
+
+/* ------------------------------------------------------------------ */
+/* cancelar_reserva: libera os k assentos a partir de 'inicio'.       */
+/* ------------------------------------------------------------------ */
+void cancelar_reserva(int fileira, int inicio, int k) {
+  travar(fileira, 1);
+  if (intencoes != NULL) {
+    intencoes[fileira] = (Intencao){INTENCAO_CANCELAMENTO, 0, inicio, k};
+  }
+  for (int a = inicio; a < inicio + k; a++) {
+    ASSENTO(fileira, a) = 0;
+    marcar_assento(fileira, a, 1);
+  }
+  publicar_dica_arvore(fileira, k);
+  if (diario_ativo) {
+    diario_anexar(REGISTRO_CANCELAMENTO, fileira, inicio, k, 0);
+  }
+  if (intencoes != NULL) {
+    intencoes[fileira].tipo = INTENCAO_NENHUMA;
+  }
+  destravar(fileira);
+}
+
+/* ------------------------------------------------------------------ */
+/* bits_validos: máscara dos bits da palavra w que correspondem a     */
+/* assentos reais (a última palavra da fileira pode ser parcial).     */
+/* ------------------------------------------------------------------ */
+static uint64_t bits_validos(int w) {
+  int restantes = sala.assentos_por_fileira - w * 64;
+  return restantes >= 64 ? ~0ULL : (1ULL << restantes) - 1;
+}
+
+/* ------------------------------------------------------------------ */
+/* inicios_livres: bit j ligado se os bits j..j+k-1 de 'livres'       */
+/* estão todos ligados. Dobra o deslocamento a cada passo: O(log k).  */
+/* ------------------------------------------------------------------ */
+static uint64_t inicios_livres(uint64_t livres, int k) {
+  uint64_t m = livres;
+  int cobertos = 1;
+  while (cobertos < k) {
+    int passo = cobertos < k - cobertos ? cobertos : k - cobertos;
+    m &= m >> passo;
+    cobertos += passo;
+  }
+  return m;
+}
+
+/* ------------------------------------------------------------------ */
+/* tomar_bits: liga 'mascara' em *palavra se todos esses bits estão   */
+/* livres (CAS, repetindo se outros bits da palavra mudarem).         */
+/* Retorna 1 se tomou, 0 se algum bit já estava ocupado.             */
+/* ------------------------------------------------------------------ */
+static int tomar_bits(_Atomic uint64_t *palavra, uint64_t mascara) {
+  uint64_t atual = atomic_load_explicit(palavra, memory_order_acquire);
+  while (!(atual & mascara)) {
+    if (atomic_compare_exchange_weak_explicit(palavra, &atual, atual | mascara,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* maior_sequencia_bits: maior sequência livre da fileira no bitmap.  */
+/* Por palavra: prefixo e sufixo livres via ctz/clz e, no meio, busca */
+/* binária no tamanho com inicios_livres.                             */
+/* ------------------------------------------------------------------ */
+static int maior_sequencia_bits(_Atomic uint64_t *bits) {
+  int maior = 0, corrente = 0;
+  for (int w = 0; w < palavras_por_fileira; w++) {
+    uint64_t livres = ~atomic_load_explicit(&bits[w], memory_order_acquire) &
+                      bits_validos(w);
+    if (livres == ~0ULL) {
+      corrente += 64;
+      if (corrente > maior) maior = corrente;
+      continue;
+    }
+    int prefixo = __builtin_ctzll(~livres);
+    if (corrente + prefixo > maior) maior = corrente + prefixo;
+    int baixo = 0, alto = 64; /* Maior k com sequência de k bits livres */
+    while (baixo < alto) {
+      int meio = (baixo + alto + 1) / 2;
+      if (inicios_livres(livres, meio) != 0) {
+        baixo = meio;
+      } else {
+        alto = meio - 1;
+      }
+    }
+    if (baixo > maior) maior = baixo;
+    corrente = __builtin_clzll(~livres);
+  }
+  return maior;
+}
+
+/* ------------------------------------------------------------------ */
+/* publicar_dica_bits: dicas da engine lock-free. Sem trava, dois     */
+/* clientes podem publicar fora de ordem; por isso, depois de gravar, */
+/* recalcula e regrava até o valor bater com o bitmap atual.          */
+/* ------------------------------------------------------------------ */
+static void publicar_dica_bits(int fileira, int delta) {
+  _Atomic uint64_t *bits = mapa_bits + (size_t)fileira * palavras_por_fileira;
+  atomic_fetch_add_explicit(&dicas[fileira].livres, delta, memory_order_relaxed);
+  int maior = maior_sequencia_bits(bits), conferido;
+  for (;;) {
+    atomic_store_explicit(&dicas[fileira].maior_sequencia, maior,
+                          memory_order_relaxed);
+    conferido = maior_sequencia_bits(bits);
+    if (conferido == maior) {
+      break;
+    }
+    maior = conferido;
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* tentar_reserva_lockfree: mesma semântica de tentar_reserva, sem    */
+/* mutex. Os inícios de sequências livres de uma palavra saem de      */
+/* poucos AND/shift (inicios_livres) e a sequência é tomada com um    */
+/* CAS; se outro cliente mudou a palavra, relê e tenta de novo. Uma   */
+/* sequência que cruza a fronteira entre palavras é tomada em duas    */
+/* partes, desfazendo a primeira se a segunda já estiver ocupada.     */
+/* ------------------------------------------------------------------ */
+int tentar_reserva_lockfree(int cliente_id, int fileira, int k) {
+  _Atomic uint64_t *bits = mapa_bits + (size_t)fileira * palavras_por_fileira;
+  uint64_t bloco = k == 64 ? ~0ULL : (1ULL << k) - 1;
+
+  for (int w = 0; w < palavras_por_fileira; w++) {
+    uint64_t atual = atomic_load_explicit(&bits[w], memory_order_acquire);
+    uint64_t livres;
+    for (;;) {
+      livres = ~atual & bits_validos(w);
+      uint64_t inicios = inicios_livres(livres, k);
+      if (inicios == 0) {
+        break;
+      }
+      int j = __builtin_ctzll(inicios);
+
+      /* Simula latência de processamento (fora de qualquer lock) */
+      simular_latencia();
+
+      if (atomic_compare_exchange_weak_explicit(
+              &bits[w], &atual, atual | (bloco << j), memory_order_acq_rel,
+              memory_order_acquire)) {
+        for (int a = 0; a < k; a++) {
+          ASSENTO(fileira, w * 64 + j + a) = cliente_id;
+        }
+        if (diario_ativo) {
+          diario_anexar(REGISTRO_RESERVA, fileira, w * 64 + j, k, cliente_id);
+        }
+        publicar_dica_bits(fileira, -k);
+        return w * 64 + j;
+      }
+      /* CAS falhou: 'atual' já traz o novo valor; procura de novo */
+    }
+
+    /* Sequência na fronteira: fim da palavra w e começo da w+1 */
+    if (w + 1 >= palavras_por_fileira) {
+      continue;
+    }
+    int sufixo = livres == ~0ULL ? 64 : __builtin_clzll(~livres);
+    uint64_t proxima = ~atomic_load_explicit(&bits[w + 1], memory_order_acquire) &
+                       bits_validos(w + 1);
+    int prefixo = proxima == ~0ULL ? 64 : __builtin_ctzll(~proxima);
+    if (sufixo == 0 || sufixo >= k || sufixo + prefixo < k) {
+      continue;
+    }
+    uint64_t parte_alta = ~0ULL << (64 - sufixo);
+    uint64_t parte_baixa = (1ULL << (k - sufixo)) - 1;
+    if (tomar_bits(&bits[w], parte_alta)) {
+      if (tomar_bits(&bits[w + 1], parte_baixa)) {
+        for (int a = 0; a < k; a++) {
+          ASSENTO(fileira, w * 64 + 64 - sufixo + a) = cliente_id;
+        }
+        if (diario_ativo) {
+          diario_anexar(REGISTRO_RESERVA, fileira, w * 64 + 64 - sufixo, k,
+                        cliente_id);
+        }
+        publicar_dica_bits(fileira, -k);
+        return w * 64 + 64 - sufixo;
+      }
+      atomic_fetch_and_explicit(&bits[w], ~parte_alta, memory_order_release);
+    }
+  }
+  return -1; /* Nenhuma sequência de k assentos nesta fileira */
+}
+
+/* ------------------------------------------------------------------ */
+/* cancelar_reserva_lockfree: apaga o dono dos assentos e só então    */
+/* devolve os bits (release), que podem estar em duas palavras.       */
+/* ------------------------------------------------------------------ */
+void cancelar_reserva_lockfree(int fileira, int inicio, int k) {
+  _Atomic uint64_t *bits = mapa_bits + (size_t)fileira * palavras_por_fileira;
+  int grupo = k;
+  /* Registra antes de devolver os bits: uma nova reserva destes */
+  /* assentos entra no diário depois deste cancelamento          */
+  if (diario_ativo) {
+    diario_anexar(REGISTRO_CANCELAMENTO, fileira, inicio, k, 0);
+  }
+  for (int a = inicio; a < inicio + k; a++) {
+    ASSENTO(fileira, a) = 0;
+  }
+  while (k > 0) {
+    int w = inicio / 64, j = inicio % 64;
+    int n = k < 64 - j ? k : 64 - j;
+    uint64_t mascara = (n == 64 ? ~0ULL : (1ULL << n) - 1) << j;
+    atomic_fetch_and_explicit(&bits[w], ~mascara, memory_order_release);
+    inicio += n;
+    k -= n;
+  }
+  publicar_dica_bits(fileira, grupo);
+}
+
+/* ------------------------------------------------------------------ */
+/* escolher_engine: configura reservar/cancelar/estrategia pelo nome. */
+/* Retorna 0 se o nome for desconhecido.                             */
+/* ------------------------------------------------------------------ */
+int escolher_engine(const char *nome) {
+  static const struct {
+    const char *nome;
+    Trava trava;
+  } com_trava[] = {{"mutex", TRAVA_MUTEX},
+                   {"global", TRAVA_GLOBAL},
+                   {"rwlock", TRAVA_RWLOCK},
+                   {"spin", TRAVA_SPIN}};
+  if (strcmp(nome, "lockfree") == 0) {
+    reservar = tentar_reserva_lockfree;
+    cancelar = cancelar_reserva_lockfree;
+    return 1;
+  }
+  for (size_t i = 0; i < sizeof(com_trava) / sizeof(com_trava[0]); i++) {
+    if (strcmp(nome, com_trava[i].nome) == 0) {
+      estrategia = com_trava[i].trava;
+      reservar = tentar_reserva;
+      cancelar = cancelar_reserva;
+      return 1;
+    }
+  }
+  return 0;
+}
 
-#define FILEIRAS 5
-#define ASSENTOS_POR_FILEIRA 10
-#define NUM_CLIENTES 20
+/* ------------------------------------------------------------------ */
+/* embaralhar_fileiras: ordem aleatória de tentativa (Fisher-Yates).  */
+/* ------------------------------------------------------------------ */
+static void embaralhar_fileiras(int *ordem, int fileiras) {
+  for (int i = 0; i < fileiras; i++) {
+    ordem[i] = i;
+  }
+  for (int i = fileiras - 1; i > 0; i--) {
+    int j = aleatorio() % (i + 1);
+    int tmp = ordem[i];
+    ordem[i] = ordem[j];
+    ordem[j] = tmp;
+  }
+}
 
-typedef struct {
-  int assentos[FILEIRAS][ASSENTOS_POR_FILEIRA];
-  int reservas_sucesso;
-  int reservas_falha;
-} Sala;
+/* ------------------------------------------------------------------ */
+/* cabe_na_fileira: a dica diz que há k assentos seguidos livres.     */
+/* ------------------------------------------------------------------ */
+static int cabe_na_fileira(int fileira, int k) {
+  return atomic_load_explicit(&dicas[fileira].maior_sequencia,
+                              memory_order_relaxed) >= k;
+}
 
-Sala sala;
+static int livres_na_fileira(int fileira) {
+  return atomic_load_explicit(&dicas[fileira].livres, memory_order_relaxed);
+}
 
-/* Mutex por fileira — protege cada fileira individualmente */
-pthread_mutex_t mutex_fileira[FILEIRAS];
+/* ------------------------------------------------------------------ */
+/* escolher_fileira: candidata para um grupo de k pela política de    */
+/* roteamento, lendo só as dicas (sem trava). Retorna -1 se nenhuma   */
+/* fileira comporta o grupo.                                          */
+/* p2c: entre duas sorteadas, a mais livre que caiba; se nenhuma das  */
+/* duas couber, a primeira que caiba a partir de um ponto aleatório.  */
+/* menos-cheia: varre todas e fica com a mais livre que caiba,        */
+/* começando de um ponto aleatório para desempatar sem manada.        */
+/* ------------------------------------------------------------------ */
+static int escolher_fileira(int k) {
+  int fileiras = sala.fileiras;
+  int inicio = aleatorio() % fileiras;
+  if (rota == ROTA_P2C) {
+    int a = inicio, b = aleatorio() % fileiras;
+    int cabe_a = cabe_na_fileira(a, k), cabe_b = cabe_na_fileira(b, k);
+    if (cabe_a && cabe_b) {
+      return livres_na_fileira(a) >= livres_na_fileira(b) ? a : b;
+    }
+    if (cabe_a || cabe_b) {
+      return cabe_a ? a : b;
+    }
+    for (int i = 0; i < fileiras; i++) {
+      int f = (inicio + i) % fileiras;
+      if (cabe_na_fileira(f, k)) {
+        return f;
+      }
+    }
+    return -1;
+  }
 
-/* Mutex para os contadores de estatísticas */
-pthread_mutex_t mutex_estatisticas;
+  int melhor = -1, melhor_livres = -1;
+  for (int i = 0; i < fileiras; i++) {
+    int f = (inicio + i) % fileiras;
+    int livres = livres_na_fileira(f);
+    if (livres > melhor_livres && cabe_na_fileira(f, k)) {
+      melhor = f;
+      melhor_livres = livres;
+    }
+  }
+  return melhor;
+}
 
 /* ------------------------------------------------------------------ */
-/* inicializar_sala: zera todos os assentos e contadores              */
+/* reservar_em_alguma_fileira: tenta o grupo de k assentos nas        */
+/* fileiras escolhidas pela política de roteamento ('ordem' é área de */
+/* rascunho com sala.fileiras posições). Retorna o primeiro assento e */
+/* a fileira em *fileira, ou -1 se nenhuma fileira comportou o grupo. */
+/* *tentadas recebe quantas fileiras foram travadas (tentativas).     */
 /* ------------------------------------------------------------------ */
-void inicializar_sala() {
-  for (int i = 0; i < FILEIRAS; i++) {
-    for (int j = 0; j < ASSENTOS_POR_FILEIRA; j++) {
-      sala.assentos[i][j] = 0; /* 0 = livre */
+int reservar_em_alguma_fileira(int cliente_id, int k, int *ordem,
+                               int *fileira, int *tentadas) {
+  *tentadas = 0;
+  if (rota == ROTA_ALEATORIA) {
+    embaralhar_fileiras(ordem, sala.fileiras);
+    for (int i = 0; i < sala.fileiras; i++) {
+      (*tentadas)++;
+      int inicio = reservar(cliente_id, ordem[i], k);
+      if (inicio >= 0) {
+        *fileira = ordem[i];
+        return inicio;
+      }
+    }
+    return -1;
+  }
+
+  /* Com dicas: cada volta trava só uma fileira candidata. Uma dica */
+  /* atrasada custa uma volta; o limite evita laço sem fim.         */
+  for (int volta = 0; volta < sala.fileiras; volta++) {
+    int f = escolher_fileira(k);
+    if (f < 0) {
+      return -1; /* Nenhuma fileira comporta o grupo: nem trava */
+    }
+    (*tentadas)++;
+    int inicio = reservar(cliente_id, f, k);
+    if (inicio >= 0) {
+      *fileira = f;
+      return inicio;
     }
   }
-  sala.reservas_sucesso = 0;
-  sala.reservas_falha = 0;
+  return -1;
 }
 
 /* ------------------------------------------------------------------ */
-/* tentar_reserva: busca par de assentos livres na fileira indicada.  */
-/* Retorna 1 se conseguiu reservar, 0 caso contrário.                */
-/* SEÇÃO CRÍTICA: protegida por mutex da fileira correspondente.     */
+/* minha_fatia: fatia de estatísticas desta thread, distribuída em    */
+/* rodízio no primeiro uso.                                           */
 /* ------------------------------------------------------------------ */
-int tentar_reserva(int cliente_id, int fileira) {
-  pthread_mutex_lock(&mutex_fileira[fileira]);
+static FatiaEstatisticas *minha_fatia(void) {
+  static atomic_int proxima_fatia;
+  static _Thread_local FatiaEstatisticas *fatia;
+  if (fatia == NULL) {
+    fatia = &fatias[atomic_fetch_add_explicit(&proxima_fatia, 1,
+                                              memory_order_relaxed) %
+                    FATIAS_ESTATISTICAS];
+  }
+  return fatia;
+}
 
-  /* Busca dois assentos adjacentes livres */
-  for (int j = 0; j < ASSENTOS_POR_FILEIRA - 1; j++) {
-    if (sala.assentos[fileira][j] == 0 && sala.assentos[fileira][j + 1] == 0) {
-      /* Simula latência de processamento */
-      usleep(rand() % 1000);
+/* ------------------------------------------------------------------ */
+/* somar_estatisticas: totais de todas as fatias. Exato depois que    */
+/* os clientes terminaram; durante a execução, uma aproximação.       */
+/* ------------------------------------------------------------------ */
+Estatisticas somar_estatisticas(void) {
+  Estatisticas total = {0, 0, 0};
+  for (int f = 0; f < FATIAS_ESTATISTICAS; f++) {
+    total.reservas_sucesso += atomic_load(&fatias[f].reservas_sucesso);
+    total.reservas_falha += atomic_load(&fatias[f].reservas_falha);
+    total.assentos_reservados += atomic_load(&fatias[f].assentos_reservados);
+  }
+  return total;
+}
 
-      /* Reserva o par de assentos, marcando com o ID do cliente */
-      sala.assentos[fileira][j] = cliente_id;
-      sala.assentos[fileira][j + 1] = cliente_id;
+/* ------------------------------------------------------------------ */
+/* registrar_cliente: imprime o resultado do cliente e atualiza os    */
+/* contadores da fatia desta thread (sem trava compartilhada). A      */
+/* mensagem vai para o log assíncrono: sem printf (e sem a trava do   */
+/* stdout) no caminho do cliente.                                     */
+/* ------------------------------------------------------------------ */
+void registrar_cliente(int cliente_id, int grupo, int fileira, int inicio) {
+  FatiaEstatisticas *fatia = minha_fatia();
+  if (inicio >= 0) {
+    LOG_ASSINCRONO("Cliente %2lld: reservou %lld assentos na fileira %lld\n",
+                   cliente_id, grupo, fileira + 1);
 
-      pthread_mutex_unlock(&mutex_fileira[fileira]);
-      return 1; /* Reserva bem-sucedida */
-    }
+    atomic_fetch_add_explicit(&fatia->reservas_sucesso, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&fatia->assentos_reservados, grupo,
+                              memory_order_relaxed);
+    return;
   }
 
-  pthread_mutex_unlock(&mutex_fileira[fileira]);
-  return 0; /* Nenhum par disponível nesta fileira */
+  /* Não conseguiu em nenhuma fileira */
+  LOG_ASSINCRONO("Cliente %2lld: não conseguiu reservar %lld assentos — desistiu\n",
+                 cliente_id, grupo);
+
+  atomic_fetch_add_explicit(&fatia->reservas_falha, 1, memory_order_relaxed);
 }
 
 /* ------------------------------------------------------------------ */
 /* cliente: função executada por cada thread cliente.                 */
-/* Tenta reservar em fileiras aleatórias; se nenhuma funcionar,      */
-/* desiste.                                                           */
+/* Tenta reservar seu grupo em fileiras aleatórias; se nenhuma        */
+/* funcionar, desiste.                                                */
 /* ------------------------------------------------------------------ */
 void *cliente(void *arg) {
-  int cliente_id = *((int *)arg);
+  Cliente *c = (Cliente *)arg;
+  semear_aleatorio((uint64_t)time(NULL) ^ ((uint64_t)c->id << 32));
 
-  /* Gera uma ordem aleatória de fileiras para tentar */
-  int ordem[FILEIRAS];
-  for (int i = 0; i < FILEIRAS; i++) {
-    ordem[i] = i;
+  int *ordem = malloc(sala.fileiras * sizeof(int));
+  int fileira = -1, tentadas;
+  int inicio =
+      reservar_em_alguma_fileira(c->id, c->grupo, ordem, &fileira, &tentadas);
+  free(ordem);
+
+  diario_confirmar();
+  registrar_cliente(c->id, c->grupo, fileira, inicio);
+  return NULL;
+}
+
+/* ================================================================== */
+/* POOL DE THREADS: pedidos numa fila MPMC limitada                   */
+/* ================================================================== */
+
+/* Um pedido atravessa a fila até um worker do pool, que o executa e    */
+/* avisa o solicitante pelo callback e/ou pelo lote (future coletivo).  */
+/* Assim uma única thread cliente mantém muitos pedidos em voo, sem     */
+/* uma pthread (e uma pilha) por comprador.                             */
+typedef enum { PEDIDO_RESERVAR, PEDIDO_CANCELAR } TipoPedido;
+
+typedef struct Lote Lote;
+typedef struct Pedido Pedido;
+
+struct Pedido {
+  TipoPedido tipo;
+  int cliente_id;
+  int grupo;
+  int fileira, inicio; /* Resultado da reserva (-1 = falhou) ou alvo */
+  int tentadas;        /* Fileiras travadas até o resultado */
+  uint64_t submetido_ns, concluido_ns;
+  void (*ao_concluir)(Pedido *); /* Callback opcional, na thread do pool */
+  void *contexto;
+  Lote *lote;
+};
+
+/* Lote: future de um conjunto de pedidos; lote_aguardar retorna quando */
+/* todos foram concluídos.                                               */
+struct Lote {
+  atomic_int pendentes;
+  pthread_mutex_t mutex;
+  pthread_cond_t concluido;
+};
+
+/* Fila MPMC limitada (Vyukov): cada posição tem um número de sequência */
+/* que diz se está livre para a volta atual do produtor ou pronta para  */
+/* o consumidor. Os semáforos contam vagas e itens, bloqueando quem      */
+/* encontra a fila cheia ou vazia.                                      */
+typedef struct {
+  atomic_size_t sequencia;
+  Pedido *pedido;
+} PosicaoFila;
+
+typedef struct {
+  PosicaoFila *posicoes;
+  size_t mascara;
+  _Alignas(64) atomic_size_t cauda; /* Próxima inserção */
+  _Alignas(64) atomic_size_t cabeca; /* Próxima retirada */
+  sem_t vagas, itens;
+} FilaPedidos;
+
+FilaPedidos fila_pedidos;
+pthread_t *workers_pool;
+int num_workers_pool;
+
+static void fila_iniciar(FilaPedidos *f, size_t capacidade) {
+  f->posicoes = malloc(capacidade * sizeof(PosicaoFila));
+  if (f->posicoes == NULL) {
+    perror("Erro ao alocar a fila de pedidos");
+    exit(1);
   }
-  /* Embaralha (Fisher-Yates) */
-  for (int i = FILEIRAS - 1; i > 0; i--) {
-    int j = rand() % (i + 1);
-    int tmp = ordem[i];
-    ordem[i] = ordem[j];
-    ordem[j] = tmp;
+  for (size_t i = 0; i < capacidade; i++) {
+    atomic_init(&f->posicoes[i].sequencia, i);
+  }
+  f->mascara = capacidade - 1;
+  atomic_init(&f->cauda, 0);
+  atomic_init(&f->cabeca, 0);
+  sem_init(&f->vagas, 0, (unsigned)capacidade);
+  sem_init(&f->itens, 0, 0);
+}
+
+static void fila_destruir(FilaPedidos *f) {
+  sem_destroy(&f->vagas);
+  sem_destroy(&f->itens);
+  free(f->posicoes);
+}
+
+static void fila_inserir(FilaPedidos *f, Pedido *p) {
+  while (sem_wait(&f->vagas) != 0) {
+  }
+  size_t pos = atomic_fetch_add_explicit(&f->cauda, 1, memory_order_relaxed);
+  PosicaoFila *slot = &f->posicoes[pos & f->mascara];
+  /* A vaga está garantida; espera só o consumidor da volta anterior */
+  /* terminar de liberar esta posição.                               */
+  while (atomic_load_explicit(&slot->sequencia, memory_order_acquire) != pos) {
+    sched_yield();
+  }
+  slot->pedido = p;
+  atomic_store_explicit(&slot->sequencia, pos + 1, memory_order_release);
+  sem_post(&f->itens);
+}
+
+static Pedido *fila_retirar(FilaPedidos *f) {
+  while (sem_wait(&f->itens) != 0) {
+  }
+  size_t pos = atomic_fetch_add_explicit(&f->cabeca, 1, memory_order_relaxed);
+  PosicaoFila *slot = &f->posicoes[pos & f->mascara];
+  while (atomic_load_explicit(&slot->sequencia, memory_order_acquire) !=
+         pos + 1) {
+    sched_yield();
   }
+  Pedido *p = slot->pedido;
+  atomic_store_explicit(&slot->sequencia, pos + f->mascara + 1,
+                        memory_order_release);
+  sem_post(&f->vagas);
+  return p;
+}
+
+void lote_iniciar(Lote *lote) {
+  atomic_init(&lote->pendentes, 0);
+  pthread_mutex_init(&lote->mutex, NULL);
+  pthread_cond_init(&lote->concluido, NULL);
+}
+
+void lote_destruir(Lote *lote) {
+  pthread_mutex_destroy(&lote->mutex);
+  pthread_cond_destroy(&lote->concluido);
+}
 
-  /* Tenta cada fileira na ordem aleatória */
-  for (int i = 0; i < FILEIRAS; i++) {
-    if (tentar_reserva(cliente_id, ordem[i])) {
-      printf("Cliente %2d: reservou par na fileira %d\n", cliente_id,
-             ordem[i] + 1);
+/* Bloqueia até todos os pedidos submetidos ao lote serem concluídos */
+void lote_aguardar(Lote *lote) {
+  pthread_mutex_lock(&lote->mutex);
+  while (atomic_load_explicit(&lote->pendentes, memory_order_acquire) > 0) {
+    pthread_cond_wait(&lote->concluido, &lote->mutex);
+  }
+  pthread_mutex_unlock(&lote->mutex);
+}
 
-      /* Atualiza contador de sucesso (seção crítica) */
-      pthread_mutex_lock(&mutex_estatisticas);
-      sala.reservas_sucesso++;
-      pthread_mutex_unlock(&mutex_estatisticas);
+/* ------------------------------------------------------------------ */
+/* trabalhador_pool: worker do pool. Retira pedidos até receber NULL  */
+/* (sinal de encerramento), executa e avisa callback e lote.          */
+/* ------------------------------------------------------------------ */
+void *trabalhador_pool(void *arg) {
+  int *ordem = malloc(sala.fileiras * sizeof(int));
+  semear_aleatorio((uint64_t)time(NULL) ^ ((uint64_t)(intptr_t)arg << 48));
 
-      return NULL;
+  Pedido *p;
+  while ((p = fila_retirar(&fila_pedidos)) != NULL) {
+    if (p->tipo == PEDIDO_RESERVAR) {
+      p->inicio = reservar_em_alguma_fileira(p->cliente_id, p->grupo, ordem,
+                                             &p->fileira, &p->tentadas);
+    } else {
+      cancelar(p->fileira, p->inicio, p->grupo);
+    }
+    diario_confirmar();
+    p->concluido_ns = agora_ns();
+    if (p->ao_concluir != NULL) {
+      p->ao_concluir(p);
     }
+    /* Decrementa sob o mutex do lote: quem aguarda só vê zero depois */
+    /* deste unlock, o último acesso ao lote, e pode então destruí-lo */
+    Lote *lote = p->lote;
+    if (lote != NULL) {
+      pthread_mutex_lock(&lote->mutex);
+      if (atomic_fetch_sub_explicit(&lote->pendentes, 1, memory_order_acq_rel) == 1) {
+        pthread_cond_broadcast(&lote->concluido);
+      }
+      pthread_mutex_unlock(&lote->mutex);
+    }
+  }
+  free(ordem);
+  return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/* pool_iniciar: cria a fila (capacidade arredondada para potência de */
+/* 2) e 'workers' threads. Usar depois de inicializar_sala.           */
+/* ------------------------------------------------------------------ */
+void pool_iniciar(int workers, int capacidade) {
+  size_t cap = 1;
+  while (cap < (size_t)capacidade) {
+    cap *= 2;
   }
+  fila_iniciar(&fila_pedidos, cap);
+  num_workers_pool = workers;
+  workers_pool = malloc(workers * sizeof(pthread_t));
+  for (int i = 0; i < workers; i++) {
+    pthread_create(&workers_pool[i], NULL, trabalhador_pool,
+                   (void *)(intptr_t)i);
+  }
+}
 
-  /* Não conseguiu em nenhuma fileira */
-  printf("Cliente %2d: não conseguiu reservar — desistiu\n", cliente_id);
+/* pool_encerrar: um NULL por worker; cada um sai ao retirá-lo */
+void pool_encerrar() {
+  for (int i = 0; i < num_workers_pool; i++) {
+    fila_inserir(&fila_pedidos, NULL);
+  }
+  for (int i = 0; i < num_workers_pool; i++) {
+    pthread_join(workers_pool[i], NULL);
+  }
+  free(workers_pool);
+  fila_destruir(&fila_pedidos);
+}
+
+/* ------------------------------------------------------------------ */
+/* pool_submeter_lote: enfileira n pedidos ligados ao lote (que pode  */
+/* ser NULL, se bastar o callback). Bloqueia só se a fila encher.     */
+/* ------------------------------------------------------------------ */
+void pool_submeter_lote(Pedido *pedidos, int n, Lote *lote) {
+  if (lote != NULL) {
+    atomic_fetch_add_explicit(&lote->pendentes, n, memory_order_relaxed);
+  }
+  for (int i = 0; i < n; i++) {
+    pedidos[i].lote = lote;
+    fila_inserir(&fila_pedidos, &pedidos[i]);
+  }
+}
+
+/* Pedido único: future de um elemento */
+void pool_submeter(Pedido *pedido, Lote *lote) {
+  pool_submeter_lote(pedido, 1, lote);
+}
+
+/* Callback do modo normal com pool: mesmo relatório de cliente() */
+static void concluir_cliente(Pedido *p) {
+  registrar_cliente(p->cliente_id, p->grupo, p->fileira, p->inicio);
+}
+
+/* ================================================================== */
+/* BENCHMARK: gerador de carga e comparação de estratégias de trava   */
+/* ================================================================== */
+
+/* Histograma log-linear de latências em ns: 16 sub-faixas por         */
+/* potência de 2 (erro relativo < 6,25%), sem alocação no caminho.      */
+#define HIST_SUBFAIXAS 16
+#define HIST_FAIXAS (64 * HIST_SUBFAIXAS)
+
+typedef struct {
+  uint64_t contagem[HIST_FAIXAS];
+  uint64_t total;
+} Histograma;
+
+static int faixa_histograma(uint64_t ns) {
+  if (ns < HIST_SUBFAIXAS) {
+    return (int)ns;
+  }
+  int bit = 63 - __builtin_clzll(ns);
+  int sub = (int)((ns >> (bit - 4)) & (HIST_SUBFAIXAS - 1));
+  return (bit - 3) * HIST_SUBFAIXAS + sub;
+}
+
+/* Maior valor (ns) que cai na faixa f */
+static uint64_t limite_faixa(int f) {
+  if (f < HIST_SUBFAIXAS) {
+    return (uint64_t)f;
+  }
+  int bit = f / HIST_SUBFAIXAS + 3, sub = f % HIST_SUBFAIXAS;
+  return ((uint64_t)(HIST_SUBFAIXAS + sub + 1) << (bit - 4)) - 1;
+}
+
+static void registrar_latencia(Histograma *h, uint64_t ns) {
+  h->contagem[faixa_histograma(ns)]++;
+  h->total++;
+}
 
-  /* Atualiza contador de falha (seção crítica) */
-  pthread_mutex_lock(&mutex_estatisticas);
-  sala.reservas_falha++;
-  pthread_mutex_unlock(&mutex_estatisticas);
+/* Percentil p (0..1) do histograma, em ns */
+static uint64_t percentil(const Histograma *h, double p) {
+  uint64_t alvo = (uint64_t)(p * h->total), acumulado = 0;
+  for (int f = 0; f < HIST_FAIXAS; f++) {
+    acumulado += h->contagem[f];
+    if (acumulado > alvo) {
+      return limite_faixa(f);
+    }
+  }
+  return 0;
+}
+
+/* Parâmetros da carga */
+typedef struct {
+  double duracao_s;
+  int cancelar_pct; /* % das operações que cancelam uma reserva própria */
+  int pensar_us;    /* Tempo de "pensar" máximo entre operações */
+  int grupo_min, grupo_max;
+  int em_voo;       /* > 0: pedidos por lote submetidos ao pool */
+  int workers, fila; /* Tamanho do pool e capacidade da fila */
+  const char *diario; /* Não NULL: journal com group commit */
+  int janela_us, lote_bytes, snapshot_a_cada;
+  int perfil; /* Mede espera e posse das travas (--perfil) */
+} Carga;
+
+/* Reserva feita por um cliente do benchmark (para cancelar depois) */
+typedef struct {
+  int fileira, inicio, k;
+} Reserva;
+
+/* Estado de um cliente do benchmark; alinhado para não dividir linha */
+/* de cache com o vizinho.                                            */
+typedef struct {
+  _Alignas(64) int id;
+  const Carga *carga;
+  Reserva *reservas;
+  int num_reservas, capacidade;
+  uint64_t sucessos, falhas, cancelamentos;
+  uint64_t tentadas; /* Fileiras travadas nas reservas */
+  long long assentos_liquidos; /* Reservados - cancelados */
+  Histograma reserva, cancelamento;
+} ClienteBench;
+
+atomic_int parar_bench;
+
+/* ------------------------------------------------------------------ */
+/* cliente_bench: laço de carga até o fim da duração. Cada operação   */
+/* é um cancelamento (com probabilidade cancelar_pct, se houver o que */
+/* cancelar) ou uma reserva de grupo, roteada como em cliente().      */
+/* ------------------------------------------------------------------ */
+void *cliente_bench(void *arg) {
+  ClienteBench *c = (ClienteBench *)arg;
+  const Carga *carga = c->carga;
+  int *ordem = malloc(sala.fileiras * sizeof(int));
+  semear_aleatorio(agora_ns() ^ ((uint64_t)c->id << 40));
+
+  while (!atomic_load_explicit(&parar_bench, memory_order_relaxed)) {
+    if (c->num_reservas > 0 && (int)(aleatorio() % 100) < carga->cancelar_pct) {
+      int r = aleatorio() % c->num_reservas;
+      Reserva alvo = c->reservas[r];
+      c->reservas[r] = c->reservas[--c->num_reservas];
+
+      uint64_t t0 = agora_ns();
+      cancelar(alvo.fileira, alvo.inicio, alvo.k);
+      diario_confirmar();
+      registrar_latencia(&c->cancelamento, agora_ns() - t0);
+      c->cancelamentos++;
+      c->assentos_liquidos -= alvo.k;
+    } else {
+      int k = carga->grupo_min +
+              aleatorio() % (carga->grupo_max - carga->grupo_min + 1);
+      uint64_t t0 = agora_ns();
+      int fileira = -1, tentadas;
+      int inicio = reservar_em_alguma_fileira(c->id, k, ordem, &fileira, &tentadas);
+      diario_confirmar();
+      registrar_latencia(&c->reserva, agora_ns() - t0);
+      c->tentadas += tentadas;
 
+      if (inicio >= 0) {
+        if (c->num_reservas == c->capacidade) {
+          c->capacidade = c->capacidade ? 2 * c->capacidade : 64;
+          c->reservas = realloc(c->reservas, c->capacidade * sizeof(Reserva));
+        }
+        c->reservas[c->num_reservas++] = (Reserva){fileira, inicio, k};
+        c->sucessos++;
+        c->assentos_liquidos += k;
+      } else {
+        c->falhas++;
+      }
+    }
+    if (carga->pensar_us > 0) {
+      usleep(aleatorio() % carga->pensar_us);
+    }
+  }
+  free(ordem);
+  return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/* cliente_bench_pool: mesma carga de cliente_bench, mas cada volta   */
+/* submete um lote de 'em_voo' pedidos ao pool e aguarda o lote. A    */
+/* latência de cada pedido vai da submissão à conclusão no worker     */
+/* (inclui a espera na fila).                                         */
+/* ------------------------------------------------------------------ */
+void *cliente_bench_pool(void *arg) {
+  ClienteBench *c = (ClienteBench *)arg;
+  const Carga *carga = c->carga;
+  Pedido *pedidos = malloc(carga->em_voo * sizeof(Pedido));
+  Lote lote;
+  lote_iniciar(&lote);
+  semear_aleatorio(agora_ns() ^ ((uint64_t)c->id << 40));
+
+  while (!atomic_load_explicit(&parar_bench, memory_order_relaxed)) {
+    for (int i = 0; i < carga->em_voo; i++) {
+      Pedido *p = &pedidos[i];
+      memset(p, 0, sizeof(*p));
+      p->cliente_id = c->id;
+      if (c->num_reservas > 0 &&
+          (int)(aleatorio() % 100) < carga->cancelar_pct) {
+        /* Sai da lista já na submissão: não é cancelada duas vezes */
+        int r = aleatorio() % c->num_reservas;
+        Reserva alvo = c->reservas[r];
+        c->reservas[r] = c->reservas[--c->num_reservas];
+        p->tipo = PEDIDO_CANCELAR;
+        p->fileira = alvo.fileira;
+        p->inicio = alvo.inicio;
+        p->grupo = alvo.k;
+      } else {
+        p->tipo = PEDIDO_RESERVAR;
+        p->grupo = carga->grupo_min +
+                   aleatorio() % (carga->grupo_max - carga->grupo_min + 1);
+      }
+      p->submetido_ns = agora_ns();
+    }
+    pool_submeter_lote(pedidos, carga->em_voo, &lote);
+    lote_aguardar(&lote);
+
+    for (int i = 0; i < carga->em_voo; i++) {
+      Pedido *p = &pedidos[i];
+      uint64_t latencia = p->concluido_ns - p->submetido_ns;
+      if (p->tipo == PEDIDO_CANCELAR) {
+        registrar_latencia(&c->cancelamento, latencia);
+        c->cancelamentos++;
+        c->assentos_liquidos -= p->grupo;
+        continue;
+      }
+      registrar_latencia(&c->reserva, latencia);
+      c->tentadas += p->tentadas;
+      if (p->inicio >= 0) {
+        if (c->num_reservas == c->capacidade) {
+          c->capacidade = c->capacidade ? 2 * c->capacidade : 64;
+          c->reservas = realloc(c->reservas, c->capacidade * sizeof(Reserva));
+        }
+        c->reservas[c->num_reservas++] =
+            (Reserva){p->fileira, p->inicio, p->grupo};
+        c->sucessos++;
+        c->assentos_liquidos += p->grupo;
+      } else {
+        c->falhas++;
+      }
+    }
+    if (carga->pensar_us > 0) {
+      usleep(aleatorio() % carga->pensar_us);
+    }
+  }
+  lote_destruir(&lote);
+  free(pedidos);
   return NULL;
 }
 
+/* ------------------------------------------------------------------ */
+/* rodar_bench: uma rodada da carga com a engine escolhida, numa sala */
+/* nova. Imprime uma linha da tabela e verifica a integridade.        */
+/* Retorna 0 se a sala terminou consistente.                          */
+/* ------------------------------------------------------------------ */
+int rodar_bench(const char *engine, int fileiras, int assentos,
+                int num_clientes, const Carga *carga) {
+  escolher_engine(engine);
+  inicializar_sala(fileiras, assentos, NULL);
+  if (carga->perfil && reservar != tentar_reserva_lockfree) {
+    perfil_iniciar(fileiras);
+  }
+  if (carga->diario != NULL) {
+    /* Cada rodada começa com diário e snapshot vazios */
+    char snapshot[4112];
+    snprintf(snapshot, sizeof(snapshot), "%s.snap", carga->diario);
+    unlink(carga->diario);
+    unlink(snapshot);
+    diario_abrir(carga->diario, carga->janela_us, (size_t)carga->lote_bytes,
+                 carga->snapshot_a_cada);
+  }
+  atomic_store(&parar_bench, 0);
+  if (carga->em_voo > 0) {
+    pool_iniciar(carga->workers, carga->fila);
+  }
+
+  pthread_t *threads = malloc(num_clientes * sizeof(pthread_t));
+  ClienteBench *clientes = aligned_alloc(64, num_clientes * sizeof(ClienteBench));
+  memset(clientes, 0, num_clientes * sizeof(ClienteBench));
+
+  uint64_t inicio = agora_ns();
+  for (int i = 0; i < num_clientes; i++) {
+    clientes[i].id = i + 1;
+    clientes[i].carga = carga;
+    pthread_create(&threads[i], NULL,
+                   carga->em_voo > 0 ? cliente_bench_pool : cliente_bench,
+                   &clientes[i]);
+  }
+  usleep((useconds_t)(carga->duracao_s * 1e6));
+  atomic_store(&parar_bench, 1);
+  for (int i = 0; i < num_clientes; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  double segundos = (agora_ns() - inicio) / 1e9;
+  if (carga->em_voo > 0) {
+    pool_encerrar();
+  }
+  if (carga->diario != NULL) {
+    diario_fechar();
+  }
+
+  /* Junta os histogramas e contadores dos clientes */
+  static Histograma reserva, cancelamento;
+  memset(&reserva, 0, sizeof(reserva));
+  memset(&cancelamento, 0, sizeof(cancelamento));
+  uint64_t sucessos = 0, falhas = 0, cancelamentos = 0, tentadas = 0;
+  long long liquidos = 0;
+  for (int i = 0; i < num_clientes; i++) {
+    for (int f = 0; f < HIST_FAIXAS; f++) {
+      reserva.contagem[f] += clientes[i].reserva.contagem[f];
+      cancelamento.contagem[f] += clientes[i].cancelamento.contagem[f];
+    }
+    reserva.total += clientes[i].reserva.total;
+    cancelamento.total += clientes[i].cancelamento.total;
+    sucessos += clientes[i].sucessos;
+    falhas += clientes[i].falhas;
+    cancelamentos += clientes[i].cancelamentos;
+    tentadas += clientes[i].tentadas;
+    liquidos += clientes[i].assentos_liquidos;
+    free(clientes[i].reservas);
+  }
+
+  long long ocupados = 0;
+  for (int i = 0; i < fileiras; i++) {
+    for (int j = 0; j < assentos; j++) {
+      ocupados += ASSENTO(i, j) != 0;
+    }
+  }
+
+  printf("%-9s %12.0f %12.0f %10.0f %8.2f %8.2f %8.2f %8.2f %8.2f %7.1f%% %s\n",
+         engine, sucessos / segundos, (sucessos + falhas) / segundos,
+         cancelamentos / segundos,
+         sucessos ? (double)tentadas / sucessos : 0.0,
+         percentil(&reserva, 0.50) / 1e3,
+         percentil(&reserva, 0.99) / 1e3, percentil(&reserva, 0.999) / 1e3,
+         percentil(&cancelamento, 0.99) / 1e3,
+         100.0 * ocupados / ((double)fileiras * assentos),
+         ocupados == liquidos ? "OK" : "ERRO");
+  if (carga->diario != NULL) {
+    printf("%-9s diário: %llu registros em %llu fdatasync (%.1f por sync), "
+           "%llu snapshots\n",
+           "", (unsigned long long)diario.registros,
+           (unsigned long long)diario.escritas,
+           diario.escritas ? (double)diario.registros / diario.escritas : 0.0,
+           (unsigned long long)diario.snapshots);
+  }
+  if (perfil != NULL) {
+    imprimir_perfil("          ");
+    perfil_encerrar();
+  }
+
+  free(threads);
+  free(clientes);
+  destruir_sala();
+  return ocupados == liquidos ? 0 : 1;
+}
+
+static const char *nome_rota(void) {
+  return rota == ROTA_P2C ? "p2c" : rota == ROTA_MENOS_CHEIA ? "menos-cheia" : "aleatoria";
+}
+
+/* ------------------------------------------------------------------ */
+/* executar_bench: roda a carga para uma engine ou para todas.        */
+/* ------------------------------------------------------------------ */
+int executar_bench(const char *engine, int fileiras, int assentos,
+                   int num_clientes, const Carga *carga) {
+  static const char *todas[] = {"mutex", "global", "rwlock", "spin", "lockfree"};
+
+  printf("=== Benchmark de Reservas ===\n");
+  printf("Fileiras: %d | Assentos por fileira: %d | Clientes: %d | Grupo: %d-%d\n"
+         "Duração: %.1f s | Cancelamentos: %d%% | Pensar: %d µs | "
+         "Latência simulada: %d µs | Rota: %s\n",
+         fileiras, assentos, num_clientes, carga->grupo_min, carga->grupo_max,
+         carga->duracao_s, carga->cancelar_pct, carga->pensar_us,
+         latencia_max_us, nome_rota());
+  if (carga->em_voo > 0) {
+    printf("Pool: %d workers | Fila: %d | Pedidos em voo por cliente: %d\n",
+           carga->workers, carga->fila, carga->em_voo);
+  }
+  if (carga->diario != NULL) {
+    printf("Diário: %s | Janela: %d µs | Lote: %d bytes | Snapshot a cada %d\n",
+           carga->diario, carga->janela_us, carga->lote_bytes,
+           carga->snapshot_a_cada);
+  }
+  printf("\n");
+  printf("%-9s %12s %12s %10s %8s %8s %8s %8s %8s %8s %s\n", "engine",
+         "reservas/s", "tentativas/s", "cancel/s", "trav/res", "p50_us", "p99_us", "p999_us",
+         "canc_p99", "ocupacao", "integridade");
+
+  int erros = 0;
+  for (size_t i = 0; i < sizeof(todas) / sizeof(todas[0]); i++) {
+    if (strcmp(engine, "todas") == 0 || strcmp(engine, todas[i]) == 0) {
+      erros += rodar_bench(todas[i], fileiras, assentos, num_clientes, carga);
+    }
+  }
+  return erros ? 1 : 0;
+}
+
 /* ------------------------------------------------------------------ */
 /* imprimir_sala: exibe mapa visual da sala.                          */
 /* "." = livre, número/letra do cliente = ocupado.                   */
+/* Salas grandes demais para o terminal não são desenhadas.           */
 /* ------------------------------------------------------------------ */
-void imprimir_sala() {
+void imprimir_sala(int num_clientes) {
+  if (sala.fileiras > 50 || sala.assentos_por_fileira > 40) {
+    printf("\n(Sala %d × %d grande demais para o mapa)\n", sala.fileiras,
+           sala.assentos_por_fileira);
+    return;
+  }
+  int largura = 3;
+  for (int c = num_clientes; c >= 100; c /= 10) {
+    largura++;
+  }
+
   printf("\n========== MAPA DA SALA ==========\n");
   printf("         ");
-  for (int j = 0; j < ASSENTOS_POR_FILEIRA; j++) {
-    printf(" %2d", j + 1);
+  for (int j = 0; j < sala.assentos_por_fileira; j++) {
+    printf("%*d", largura, j + 1);
   }
   printf("\n");
 
-  for (int i = 0; i < FILEIRAS; i++) {
+  for (int i = 0; i < sala.fileiras; i++) {
     printf("Fileira %d:", i + 1);
-    for (int j = 0; j < ASSENTOS_POR_FILEIRA; j++) {
-      if (sala.assentos[i][j] == 0) {
-        printf("  .");
+    for (int j = 0; j < sala.assentos_por_fileira; j++) {
+      if (ASSENTO(i, j) == 0) {
+        printf("%*s", largura, ".");
       } else {
-        printf(" %2d", sala.assentos[i][j]);
+        printf("%*d", largura, ASSENTO(i, j));
       }
     }
     printf("\n");
@@ -146,77 +2253,344 @@ void imprimir_sala() {
   printf("==================================\n");
 }
 
+/* ------------------------------------------------------------------ */
+/* ler_inteiro: converte argv em inteiro >= minimo; -1 se inválido.   */
+/* ------------------------------------------------------------------ */
+static int ler_inteiro(const char *texto, int minimo) {
+  char *fim;
+  long valor = strtol(texto, &fim, 10);
+  if (*texto == '\0' || *fim != '\0' || valor < minimo || valor > 100000000) {
+    return -1;
+  }
+  return (int)valor;
+}
+
 /* ------------------------------------------------------------------ */
 /* main                                                               */
 /* ------------------------------------------------------------------ */
-int main() {
+int main(int argc, char *argv[]) {
   srand(time(NULL));
 
-  /* Inicializa mutexes */
-  for (int i = 0; i < FILEIRAS; i++) {
-    pthread_mutex_init(&mutex_fileira[i], NULL);
+  /* Lê engine, dimensões da sala, número de clientes e tamanho dos grupos */
+  const char *engine = "mutex";
+  int fileiras = FILEIRAS, assentos = ASSENTOS_POR_FILEIRA;
+  int num_clientes = NUM_CLIENTES, grupo_min = 2, grupo_max = 2;
+  int bench = 0, latencia = -1, clientes_definidos = 0, usar_pool = 0;
+  const char *arquivo_sala = NULL;
+  int nucleos = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  Carga carga = {5.0, 30, 0, 0, 0, 32, nucleos, 1024, NULL, 1000, 65536, 10000, 0};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bench") == 0) {
+      bench = 1;
+      continue;
+    }
+    if (strcmp(argv[i], "--pool") == 0) {
+      usar_pool = 1;
+      continue;
+    }
+    if (strcmp(argv[i], "--perfil") == 0) {
+      carga.perfil = 1;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      fprintf(stderr,
+              "Uso: %s [--engine mutex|global|rwlock|spin|lockfree]\n"
+              "          [--fileiras F] [--assentos S] [--clientes C]\n"
+              "          [--grupo K | --grupo A-B] [--latencia US]\n"
+              "       %s --bench [--engine E|todas] [--duracao S] "
+              "[--cancelar P] [--pensar US] ...\n"
+              "       (ambos) --pool [--workers W] [--fila N] [--em-voo M]\n"
+              "               --rota aleatoria|p2c|menos-cheia\n"
+              "       %s --sala ARQUIVO [...]  (sala compartilhada entre processos)\n"
+              "       (ambos) --diario ARQUIVO [--janela US] [--lote-bytes B] "
+              "[--snapshot N]\n"
+              "       (ambos) --perfil  (espera e posse das travas por fileira)\n",
+              argv[0], argv[0], argv[0]);
+      return 1;
+    }
+    const char *opcao = argv[i], *valor = argv[++i];
+    if (strcmp(opcao, "--engine") == 0) {
+      engine = valor;
+    } else if (strcmp(opcao, "--fileiras") == 0) {
+      fileiras = ler_inteiro(valor, 1);
+    } else if (strcmp(opcao, "--assentos") == 0) {
+      assentos = ler_inteiro(valor, 1);
+    } else if (strcmp(opcao, "--clientes") == 0) {
+      num_clientes = ler_inteiro(valor, 1);
+      clientes_definidos = 1;
+    } else if (strcmp(opcao, "--grupo") == 0) {
+      if (sscanf(valor, "%d-%d", &grupo_min, &grupo_max) == 1) {
+        grupo_max = grupo_min;
+      }
+    } else if (strcmp(opcao, "--latencia") == 0) {
+      latencia = ler_inteiro(valor, 0);
+      if (latencia < 0) {
+        fprintf(stderr, "Erro: latência deve ser um inteiro >= 0\n");
+        return 1;
+      }
+    } else if (strcmp(opcao, "--duracao") == 0) {
+      carga.duracao_s = atof(valor);
+    } else if (strcmp(opcao, "--cancelar") == 0) {
+      carga.cancelar_pct = ler_inteiro(valor, 0);
+    } else if (strcmp(opcao, "--pensar") == 0) {
+      carga.pensar_us = ler_inteiro(valor, 0);
+    } else if (strcmp(opcao, "--sala") == 0) {
+      arquivo_sala = valor;
+    } else if (strcmp(opcao, "--rota") == 0) {
+      if (strcmp(valor, "aleatoria") == 0) {
+        rota = ROTA_ALEATORIA;
+      } else if (strcmp(valor, "p2c") == 0) {
+        rota = ROTA_P2C;
+      } else if (strcmp(valor, "menos-cheia") == 0) {
+        rota = ROTA_MENOS_CHEIA;
+      } else {
+        fprintf(stderr, "Erro: rota '%s' desconhecida "
+                        "(use aleatoria, p2c ou menos-cheia)\n", valor);
+        return 1;
+      }
+    } else if (strcmp(opcao, "--workers") == 0) {
+      carga.workers = ler_inteiro(valor, 1);
+    } else if (strcmp(opcao, "--fila") == 0) {
+      carga.fila = ler_inteiro(valor, 1);
+    } else if (strcmp(opcao, "--em-voo") == 0) {
+      carga.em_voo = ler_inteiro(valor, 1);
+    } else if (strcmp(opcao, "--diario") == 0) {
+      carga.diario = valor;
+    } else if (strcmp(opcao, "--janela") == 0) {
+      carga.janela_us = ler_inteiro(valor, 0);
+    } else if (strcmp(opcao, "--lote-bytes") == 0) {
+      carga.lote_bytes = ler_inteiro(valor, 1);
+    } else if (strcmp(opcao, "--snapshot") == 0) {
+      carga.snapshot_a_cada = ler_inteiro(valor, 0);
+    } else {
+      fprintf(stderr, "Erro: opção desconhecida '%s'\n", opcao);
+      return 1;
+    }
+  }
+  if (!(bench && strcmp(engine, "todas") == 0) && !escolher_engine(engine)) {
+    fprintf(stderr,
+            "Erro: engine '%s' desconhecida "
+            "(use mutex, global, rwlock, spin ou lockfree)\n",
+            engine);
+    return 1;
+  }
+  if (fileiras < 1 || assentos < 1 || num_clientes < 1) {
+    fprintf(stderr, "Erro: fileiras, assentos e clientes devem ser inteiros >= 1\n");
+    return 1;
+  }
+  if (grupo_min < 1 || grupo_min > grupo_max || grupo_max > assentos ||
+      grupo_max > GRUPO_MAXIMO) {
+    fprintf(stderr, "Erro: grupo deve estar entre 1 e min(assentos, %d)\n",
+            GRUPO_MAXIMO);
+    return 1;
+  }
+  if (carga.workers < 1 || carga.fila < 1 || carga.fila > (1 << 24) ||
+      carga.em_voo < 1) {
+    fprintf(stderr, "Erro: workers, em-voo >= 1 e fila entre 1 e 2^24\n");
+    return 1;
+  }
+  if (!usar_pool) {
+    carga.em_voo = 0;
+  }
+  if (carga.janela_us < 0 || carga.lote_bytes < 1 || carga.snapshot_a_cada < 0) {
+    fprintf(stderr, "Erro: janela >= 0, lote-bytes >= 1 e snapshot >= 0 "
+                    "(0 desliga os snapshots)\n");
+    return 1;
+  }
+  if (carga.diario != NULL && arquivo_sala != NULL) {
+    fprintf(stderr, "Erro: --diario e --sala não podem ser usados juntos\n");
+    return 1;
+  }
+
+  if (arquivo_sala != NULL &&
+      (bench || reservar != tentar_reserva || estrategia != TRAVA_MUTEX)) {
+    fprintf(stderr, "Erro: --sala só vale fora do --bench, com a engine mutex "
+                    "(a lockfree não recupera reservas de processos mortos)\n");
+    return 1;
+  }
+
+  if (bench) {
+    /* No benchmark, a latência simulada fica desligada por padrão e há */
+    /* um cliente por núcleo, salvo indicação em contrário.             */
+    latencia_max_us = latencia >= 0 ? latencia : 0;
+    if (!clientes_definidos) {
+      num_clientes = nucleos;
+    }
+    if (carga.duracao_s <= 0 || carga.cancelar_pct < 0 ||
+        carga.cancelar_pct > 100 || carga.pensar_us < 0) {
+      fprintf(stderr, "Erro: requer duração > 0, cancelar em 0..100 e pensar >= 0\n");
+      return 1;
+    }
+    carga.grupo_min = grupo_min;
+    carga.grupo_max = grupo_max;
+    return executar_bench(engine, fileiras, assentos, num_clientes, &carga);
+  }
+  if (latencia >= 0) {
+    latencia_max_us = latencia;
   }
-  pthread_mutex_init(&mutex_estatisticas, NULL);
 
-  /* Inicializa sala */
-  inicializar_sala();
+  /* Inicializa sala e travas; uma sala compartilhada existente impõe */
+  /* suas dimensões                                                    */
+  inicializar_sala(fileiras, assentos, arquivo_sala);
+  fileiras = sala.fileiras;
+  assentos = sala.assentos_por_fileira;
+  if (grupo_max > assentos) {
+    fprintf(stderr, "Erro: grupo maior que as fileiras da sala (%d assentos)\n",
+            assentos);
+    destruir_sala();
+    return 1;
+  }
+  /* IDs únicos entre os processos que usam a mesma sala */
+  int base_id = cabecalho != NULL
+                    ? atomic_fetch_add(&cabecalho->proximo_cliente, num_clientes)
+                    : 0;
+  /* Com diário, a sala volta como estava; os novos IDs vêm depois dos */
+  /* que já têm assento                                               */
+  if (carga.perfil && reservar != tentar_reserva_lockfree) {
+    perfil_iniciar(fileiras);
+  }
+  if (carga.diario != NULL) {
+    base_id = diario_abrir(carga.diario, carga.janela_us,
+                           (size_t)carga.lote_bytes, carga.snapshot_a_cada);
+  }
 
-  /* Cria threads de clientes */
-  pthread_t threads[NUM_CLIENTES];
-  int ids[NUM_CLIENTES];
+  /* Cria threads de clientes (ou pedidos ao pool); cada um sorteia o */
+  /* tamanho do seu grupo                                              */
+  pthread_t *threads = malloc(num_clientes * sizeof(pthread_t));
+  Cliente *clientes = malloc(num_clientes * sizeof(Cliente));
+  Pedido *pedidos = usar_pool ? calloc(num_clientes, sizeof(Pedido)) : NULL;
 
   printf("=== Sistema de Reserva de Cinema ===\n");
-  printf("Fileiras: %d | Assentos por fileira: %d | Clientes: %d\n\n", FILEIRAS,
-         ASSENTOS_POR_FILEIRA, NUM_CLIENTES);
+  printf("Fileiras: %d | Assentos por fileira: %d | Clientes: %d | "
+         "Grupo: %d-%d | Engine: %s | Rota: %s\n",
+         fileiras, assentos, num_clientes, grupo_min, grupo_max, engine,
+         nome_rota());
+  if (usar_pool) {
+    printf("Pool: %d workers | Fila: %d\n", carga.workers, carga.fila);
+  }
+  if (cabecalho != NULL) {
+    printf("Sala compartilhada: %s | IDs deste processo: %d a %d\n",
+           arquivo_sala, base_id + 1, base_id + num_clientes);
+  }
+  if (carga.diario != NULL) {
+    printf("Diário: %s | Janela: %d µs | IDs desta execução: %d a %d\n",
+           carga.diario, carga.janela_us, base_id + 1, base_id + num_clientes);
+  }
+  printf("\n");
 
-  for (int i = 0; i < NUM_CLIENTES; i++) {
-    ids[i] = i + 1; /* IDs de 1 a 20 */
-    pthread_create(&threads[i], NULL, cliente, &ids[i]);
+  log_iniciar(STDOUT_FILENO);
+  struct timespec inicio, fim;
+  clock_gettime(CLOCK_MONOTONIC, &inicio);
+
+  for (int i = 0; i < num_clientes; i++) {
+    clientes[i].id = base_id + i + 1; /* IDs de 1 a num_clientes */
+    clientes[i].grupo = grupo_min + rand() % (grupo_max - grupo_min + 1);
   }
 
-  /* Aguarda todas as threads terminarem */
-  for (int i = 0; i < NUM_CLIENTES; i++) {
-    pthread_join(threads[i], NULL);
+  if (usar_pool) {
+    /* Todos os pedidos num lote só; o callback faz o relatório */
+    pool_iniciar(carga.workers, carga.fila);
+    Lote lote;
+    lote_iniciar(&lote);
+    for (int i = 0; i < num_clientes; i++) {
+      pedidos[i].tipo = PEDIDO_RESERVAR;
+      pedidos[i].cliente_id = clientes[i].id;
+      pedidos[i].grupo = clientes[i].grupo;
+      pedidos[i].ao_concluir = concluir_cliente;
+    }
+    pool_submeter_lote(pedidos, num_clientes, &lote);
+    lote_aguardar(&lote);
+    lote_destruir(&lote);
+    pool_encerrar();
+  } else {
+    for (int i = 0; i < num_clientes; i++) {
+      pthread_create(&threads[i], NULL, cliente, &clientes[i]);
+    }
+
+    /* Aguarda todas as threads terminarem */
+    for (int i = 0; i < num_clientes; i++) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &fim);
+  double segundos =
+      (fim.tv_sec - inicio.tv_sec) + (fim.tv_nsec - inicio.tv_nsec) / 1e9;
+  log_encerrar();
+  if (carga.diario != NULL) {
+    diario_fechar();
   }
 
   /* Exibe resultados */
-  imprimir_sala();
+  imprimir_sala(cabecalho != NULL ? atomic_load(&cabecalho->proximo_cliente)
+                                  : base_id + num_clientes);
 
-  /* Conta assentos ocupados para verificação */
-  int total_ocupados = 0;
-  for (int i = 0; i < FILEIRAS; i++) {
-    for (int j = 0; j < ASSENTOS_POR_FILEIRA; j++) {
-      if (sala.assentos[i][j] != 0) {
+  /* Conta assentos ocupados para verificação. Na sala compartilhada, */
+  /* a integridade confere só os assentos com IDs deste processo, pois */
+  /* os outros podem estar reservando agora mesmo.                     */
+  int total_ocupados = 0, ocupados_sala = 0;
+  for (int i = 0; i < fileiras; i++) {
+    for (int j = 0; j < assentos; j++) {
+      int id = ASSENTO(i, j);
+      ocupados_sala += id != 0;
+      if (id > base_id && id <= base_id + num_clientes) {
         total_ocupados++;
       }
     }
   }
+  Estatisticas total = somar_estatisticas();
+  if (cabecalho != NULL) {
+    atomic_fetch_add(&cabecalho->reservas_sucesso, total.reservas_sucesso);
+    atomic_fetch_add(&cabecalho->reservas_falha, total.reservas_falha);
+    atomic_fetch_add(&cabecalho->assentos_reservados, total.assentos_reservados);
+  }
 
   printf("\n========== ESTATÍSTICAS ==========\n");
-  printf("Total de assentos reservados: %d / %d\n", total_ocupados,
-         FILEIRAS * ASSENTOS_POR_FILEIRA);
-  printf("Clientes atendidos (sucesso): %d\n", sala.reservas_sucesso);
-  printf("Clientes que desistiram:      %d\n", sala.reservas_falha);
+  printf(cabecalho != NULL ? "Assentos reservados (este processo): %d / %d\n"
+                            : "Total de assentos reservados: %d / %d\n",
+         total_ocupados, fileiras * assentos);
+  printf("Clientes atendidos (sucesso): %lld\n", total.reservas_sucesso);
+  printf("Clientes que desistiram:      %lld\n", total.reservas_falha);
+  printf("Tempo total: %.1f ms | Reservas/s: %.0f\n", segundos * 1000,
+         total.reservas_sucesso / segundos);
+  if (carga.diario != NULL) {
+    printf("Diário: %llu registros em %llu fdatasync | %d assentos de "
+           "execuções anteriores\n",
+           (unsigned long long)diario.registros,
+           (unsigned long long)diario.escritas, ocupados_sala - total_ocupados);
+  }
+  if (cabecalho != NULL) {
+    printf("Sala (todos os processos): %d / %d ocupados | %lld atendidos | "
+           "%lld desistiram\n",
+           ocupados_sala, fileiras * assentos,
+           (long long)atomic_load(&cabecalho->reservas_sucesso),
+           (long long)atomic_load(&cabecalho->reservas_falha));
+  }
   printf("==================================\n");
+  if (perfil != NULL) {
+    printf("\n");
+    imprimir_perfil("");
+    perfil_encerrar();
+  }
 
   /* Verificação de integridade */
   printf("\n=== Verificação de Integridade ===\n");
-  if (total_ocupados == 2 * sala.reservas_sucesso) {
-    printf("OK: assentos ocupados (%d) = 2 × clientes atendidos (%d)\n",
-           total_ocupados, sala.reservas_sucesso);
+  if (total_ocupados == total.assentos_reservados) {
+    printf("OK: assentos ocupados (%d) = soma dos grupos atendidos (%lld)\n",
+           total_ocupados, total.assentos_reservados);
   } else {
-    printf("ERRO: assentos ocupados (%d) != 2 × clientes atendidos (%d)\n",
-           total_ocupados, sala.reservas_sucesso);
+    printf("ERRO: assentos ocupados (%d) != soma dos grupos atendidos (%lld)\n",
+           total_ocupados, total.assentos_reservados);
   }
 
-  printf("Total de clientes: %d (sucesso + falha = %d)\n", NUM_CLIENTES,
-         sala.reservas_sucesso + sala.reservas_falha);
+  printf("Total de clientes: %d (sucesso + falha = %lld)\n", num_clientes,
+         total.reservas_sucesso + total.reservas_falha);
 
-  /* Destrói mutexes */
-  for (int i = 0; i < FILEIRAS; i++) {
-    pthread_mutex_destroy(&mutex_fileira[i]);
-  }
-  pthread_mutex_destroy(&mutex_estatisticas);
+  /* Destrói travas e libera a sala */
+  destruir_sala();
+  free(threads);
+  free(clientes);
+  free(pedidos);
 
   return 0;
 }
@@ -0,0 +1,250 @@
+// log_assincrono.h — log assíncrono sem trava, só de cabeçalho.
+//
+// Cada thread produtora escreve registros de tamanho fixo (formato +
+// até LOG_MAX_ARGS inteiros) num anel SPSC próprio. No caminho quente
+// não há formatação, trava nem syscall. Uma thread consumidora
+// destacada, de pilha pequena e nice alto, formata os registros e os
+// grava em blocos grandes com write. Com o anel cheio, o registro é
+// descartado e contado, e o consumidor informa quantos se perderam.
+//
+// Uso:
+//     log_iniciar(STDOUT_FILENO);
+//     LOG_ASSINCRONO("Cliente %lld reservou %lld assentos\n", id, k);
+//     log_encerrar(); // esvazia os anéis antes de voltar
+//
+// O formato deve ser um literal (só o ponteiro é guardado) e usar %lld
+// para todos os argumentos, que são convertidos para long long. Sem
+// log_iniciar, LOG_ASSINCRONO imprime direto com printf. Quem registra
+// rajadas maiores pode definir LOG_CAPACIDADE_ANEL antes do #include;
+// as páginas do anel só ocupam memória quando usadas.
+// A ordem é preservada entre os registros de uma mesma thread.
+
+#ifndef LOG_ASSINCRONO_H
+#define LOG_ASSINCRONO_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define LOG_MAX_ARGS 6
+#ifndef LOG_CAPACIDADE_ANEL
+#define LOG_CAPACIDADE_ANEL 1024 // Registros por thread (potência de 2)
+#endif
+#define LOG_BUFFER_SAIDA (64 * 1024)
+#define LOG_PILHA_CONSUMIDOR (64 * 1024)
+#define LOG_NICE_CONSUMIDOR 10
+#define LOG_ESPERA_US 1000 // Pausa do consumidor quando não há nada
+
+// 64 bytes: uma linha de cache por registro
+typedef struct {
+    const char *formato;
+    long long args[LOG_MAX_ARGS];
+    long long reservado;
+} RegistroLog;
+
+enum { ANEL_LIVRE, ANEL_EM_USO, ANEL_ABANDONADO };
+
+typedef struct AnelLog {
+    _Alignas(64) atomic_size_t cabeca; // Escrito só pelo produtor
+    atomic_ullong descartados;
+    _Alignas(64) atomic_size_t cauda; // Escrito só pelo consumidor
+    atomic_int estado;
+    struct AnelLog *proximo; // Lista de anéis; só cresce
+    RegistroLog registros[LOG_CAPACIDADE_ANEL];
+} AnelLog;
+
+static struct {
+    _Atomic(AnelLog *) aneis;
+    atomic_int ativo, encerrar, encerrado;
+    int fd;
+    pthread_key_t chave; // Destrutor marca o anel da thread que saiu
+} log_estado;
+
+static _Thread_local AnelLog *log_anel_da_thread;
+
+// Thread terminou: o consumidor esvazia o anel e o devolve para reuso
+static void log_abandonar_anel(void *anel) {
+    atomic_store_explicit(&((AnelLog *)anel)->estado, ANEL_ABANDONADO,
+                          memory_order_release);
+}
+
+static void log_criar_chave(void) {
+    pthread_key_create(&log_estado.chave, log_abandonar_anel);
+}
+
+// Primeiro registro da thread: reaproveita um anel livre ou cria outro
+static AnelLog *log_obter_anel(void) {
+    for (AnelLog *a = atomic_load_explicit(&log_estado.aneis, memory_order_acquire);
+         a != NULL; a = a->proximo) {
+        int livre = ANEL_LIVRE;
+        if (atomic_compare_exchange_strong(&a->estado, &livre, ANEL_EM_USO)) {
+            pthread_setspecific(log_estado.chave, a);
+            return a;
+        }
+    }
+    AnelLog *a = aligned_alloc(64, sizeof(AnelLog));
+    if (a == NULL) {
+        return NULL;
+    }
+    atomic_init(&a->cabeca, 0);
+    atomic_init(&a->cauda, 0);
+    atomic_init(&a->descartados, 0);
+    atomic_init(&a->estado, ANEL_EM_USO);
+    a->proximo = atomic_load_explicit(&log_estado.aneis, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&log_estado.aneis, &a->proximo, a,
+                                                  memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    pthread_setspecific(log_estado.chave, a);
+    return a;
+}
+
+static inline void log_anexar(const char *formato, const long long *args) {
+    if (!atomic_load_explicit(&log_estado.ativo, memory_order_relaxed)) {
+        printf(formato, args[0], args[1], args[2], args[3], args[4], args[5]);
+        return;
+    }
+    AnelLog *a = log_anel_da_thread;
+    if (a == NULL && (a = log_anel_da_thread = log_obter_anel()) == NULL) {
+        return;
+    }
+    size_t cabeca = atomic_load_explicit(&a->cabeca, memory_order_relaxed);
+    if (cabeca - atomic_load_explicit(&a->cauda, memory_order_acquire) ==
+        LOG_CAPACIDADE_ANEL) {
+        atomic_fetch_add_explicit(&a->descartados, 1, memory_order_relaxed);
+        return;
+    }
+    RegistroLog *r = &a->registros[cabeca & (LOG_CAPACIDADE_ANEL - 1)];
+    r->formato = formato;
+    memcpy(r->args, args, sizeof(r->args));
+    atomic_store_explicit(&a->cabeca, cabeca + 1, memory_order_release);
+}
+
+// Os argumentos viram um vetor de long long, completado com zeros
+#define LOG_ASSINCRONO(formato, ...) \
+    log_anexar((formato), (const long long[LOG_MAX_ARGS + 1]){0, __VA_ARGS__} + 1)
+
+static void log_gravar(const char *dados, size_t tamanho) {
+    while (tamanho > 0) {
+        ssize_t n = write(log_estado.fd, dados, tamanho);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return; // Saída fechada: o log se perde, o programa segue
+        dados += n;
+        tamanho -= (size_t)n;
+    }
+}
+
+// Garante ao menos LOG_LINHA_MAXIMA bytes livres no buffer de saída
+#define LOG_LINHA_MAXIMA 512
+
+static void log_abrir_espaco(char *saida, size_t *usados) {
+    if (*usados > LOG_BUFFER_SAIDA - LOG_LINHA_MAXIMA) {
+        log_gravar(saida, *usados);
+        *usados = 0;
+    }
+}
+
+// Soma ao buffer o que snprintf escreveu (linhas longas saem truncadas)
+static void log_avancar(size_t *usados, int n) {
+    if (n > 0) {
+        *usados += n < LOG_LINHA_MAXIMA ? (size_t)n : LOG_LINHA_MAXIMA - 1;
+    }
+}
+
+// Uma passada por todos os anéis; devolve quantos registros formatou
+static size_t log_esvaziar(char *saida, size_t *usados) {
+    size_t total = 0;
+    for (AnelLog *a = atomic_load_explicit(&log_estado.aneis, memory_order_acquire);
+         a != NULL; a = a->proximo) {
+        int estado = atomic_load_explicit(&a->estado, memory_order_acquire);
+        size_t cauda = atomic_load_explicit(&a->cauda, memory_order_relaxed);
+        size_t cabeca = atomic_load_explicit(&a->cabeca, memory_order_acquire);
+        for (; cauda != cabeca; cauda++, total++) {
+            const RegistroLog *r = &a->registros[cauda & (LOG_CAPACIDADE_ANEL - 1)];
+            log_abrir_espaco(saida, usados);
+            log_avancar(usados, snprintf(saida + *usados, LOG_LINHA_MAXIMA, r->formato,
+                                         r->args[0], r->args[1], r->args[2],
+                                         r->args[3], r->args[4], r->args[5]));
+            atomic_store_explicit(&a->cauda, cauda + 1, memory_order_release);
+        }
+        unsigned long long perdidos = atomic_exchange(&a->descartados, 0);
+        if (perdidos > 0) {
+            log_abrir_espaco(saida, usados);
+            log_avancar(usados, snprintf(saida + *usados, LOG_LINHA_MAXIMA,
+                                         "[log] %llu registros descartados (anel cheio)\n",
+                                         perdidos));
+        }
+        if (estado == ANEL_ABANDONADO && cauda == cabeca) {
+            atomic_store_explicit(&a->estado, ANEL_LIVRE, memory_order_release);
+        }
+    }
+    return total;
+}
+
+static void *log_consumidor(void *arg) {
+    (void)arg;
+    // Prioridade baixa só para esta thread (no Linux, nice é por thread)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), LOG_NICE_CONSUMIDOR);
+    char *saida = malloc(LOG_BUFFER_SAIDA);
+    size_t usados = 0;
+    for (;;) {
+        int encerrar = atomic_load(&log_estado.encerrar);
+        size_t lidos = log_esvaziar(saida, &usados);
+        if (usados > 0) {
+            log_gravar(saida, usados);
+            usados = 0;
+        }
+        if (encerrar && lidos == 0) {
+            break;
+        }
+        if (lidos == 0) {
+            usleep(LOG_ESPERA_US);
+        }
+    }
+    free(saida);
+    atomic_store(&log_estado.encerrado, 1);
+    return NULL;
+}
+
+// Liga o log, gravando em fd. Descarrega o stdout antes, para que o que
+// já foi impresso com printf saia antes dos registros do log.
+static void log_iniciar(int fd) {
+    fflush(stdout);
+    log_estado.fd = fd;
+    atomic_store(&log_estado.encerrar, 0);
+    atomic_store(&log_estado.encerrado, 0);
+    static pthread_once_t chave_criada = PTHREAD_ONCE_INIT;
+    pthread_once(&chave_criada, log_criar_chave);
+
+    pthread_t t;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LOG_PILHA_CONSUMIDOR);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&t, &attr, log_consumidor, NULL) == 0) {
+        atomic_store(&log_estado.ativo, 1);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// Desliga o log e espera o consumidor gravar tudo o que estava nos anéis.
+// Os produtores devem ter parado de registrar.
+static void log_encerrar(void) {
+    if (!atomic_load(&log_estado.ativo)) {
+        return;
+    }
+    atomic_store(&log_estado.encerrar, 1);
+    while (!atomic_load(&log_estado.encerrado)) {
+        usleep(LOG_ESPERA_US);
+    }
+    atomic_store(&log_estado.ativo, 0);
+}
+
+#endif
@@ -1,67 +1,325 @@
+#define _GNU_SOURCE // SCHED_BATCH, SCHED_IDLE e afinidade de CPU
 #include <stdio.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "log_assincrono.h"
 
 #define PILHA_MAIOR (1024*1024) // 1 MB
 #define PILHA_MENOR (64*1024) // 64 KB
 #define NOT_DETACHED 0
 #define DETACHED 1
+#define QUALQUER_CPU -1
 
-pthread_attr_t criar_atributos(size_t tamanho_pilha, int detached) {
+// Política, prioridade e CPU de uma thread
+typedef struct {
+    int politica;   // SCHED_OTHER, SCHED_BATCH, SCHED_IDLE ou SCHED_FIFO
+    int prioridade; // 1..99 em SCHED_FIFO; 0 nas demais
+    int cpu;        // Núcleo fixo, ou QUALQUER_CPU
+} Escalonamento;
+
+#define ESCALONAMENTO_PADRAO ((Escalonamento){SCHED_OTHER, 0, QUALQUER_CPU})
+
+pthread_attr_t criar_atributos(size_t tamanho_pilha, int detached, Escalonamento esc) {
     pthread_attr_t attr;
     pthread_attr_init(&attr);
     pthread_attr_setstacksize(&attr, tamanho_pilha);
     pthread_attr_setdetachstate(&attr, detached ? PTHREAD_CREATE_DETACHED : PTHREAD_CREATE_JOINABLE); 
+    // Sem EXPLICIT_SCHED a thread herda a política de quem a cria e ignora as abaixo
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, esc.politica);
+    struct sched_param param = { .sched_priority = esc.prioridade };
+    pthread_attr_setschedparam(&attr, &param);
+    if (esc.cpu != QUALQUER_CPU) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(esc.cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
     return attr;
 }
 
-void imprimir_tamanho_pilha(const char *nome) {
+// Cria a thread com os atributos acima; devolve o erro de pthread_create
+// (EPERM: SCHED_FIFO sem root ou CAP_SYS_NICE)
+int criar_thread(pthread_t *t, size_t tamanho_pilha, int detached, Escalonamento esc,
+                 void *(*tarefa)(void *), void *arg) {
+    pthread_attr_t attr = criar_atributos(tamanho_pilha, detached, esc);
+    int erro = pthread_create(t, &attr, tarefa, arg);
+    pthread_attr_destroy(&attr);
+    return erro;
+}
+
+const char *nome_politica(int politica) {
+    switch (politica) {
+        case SCHED_BATCH: return "BATCH";
+        case SCHED_IDLE: return "IDLE";
+        case SCHED_FIFO: return "FIFO";
+        default: return "OTHER";
+    }
+}
+
+// Devolve -1 para nome desconhecido
+int ler_politica(const char *nome) {
+    int politicas[] = {SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO};
+    for (int i=0; i<4; i++) {
+        if (strcasecmp(nome, nome_politica(politicas[i])) == 0) return politicas[i];
+    }
+    return -1;
+}
+
+void descrever(Escalonamento esc, char *texto, size_t tamanho) {
+    int n = snprintf(texto, tamanho, "%s", nome_politica(esc.politica));
+    if (esc.politica == SCHED_FIFO) n += snprintf(texto + n, tamanho - n, "/%d", esc.prioridade);
+    if (esc.cpu != QUALQUER_CPU) snprintf(texto + n, tamanho - n, " cpu%d", esc.cpu);
+}
+
+// formato: mensagem com um %lld para o tamanho (o log só guarda inteiros)
+void imprimir_tamanho_pilha(const char *formato) {
     pthread_attr_t attr;
     size_t tamanho_pilha;
 
     pthread_attr_init(&attr);
     pthread_attr_getstacksize(&attr, &tamanho_pilha);
-    printf("%s: Tamanho da pilha = %zu bytes\n", nome, tamanho_pilha);
+    LOG_ASSINCRONO(formato, (long long)tamanho_pilha);
     pthread_attr_destroy(&attr);
 }
 
 void *tarefa_processamento(void *arg) {
-    imprimir_tamanho_pilha("Thread Processamento");
-    printf("Thread de processamento executando...\n");
+    imprimir_tamanho_pilha("Thread Processamento: Tamanho da pilha = %lld bytes\n");
+    LOG_ASSINCRONO("Thread de processamento executando...\n");
     for (long i=0; i<999999999; i++); // simula um processamento pesado
-    printf("...\n");
+    LOG_ASSINCRONO("...\n");
     sleep(20);
-    printf("Thread de processamento finalizada.\n");
+    LOG_ASSINCRONO("Thread de processamento finalizada.\n");
     return NULL;
 }
 
 void *tarefa_log(void *arg) {
-    imprimir_tamanho_pilha("Thread log");
-    printf("Thread de log executando...\n");
+    imprimir_tamanho_pilha("Thread log: Tamanho da pilha = %lld bytes\n");
+    LOG_ASSINCRONO("Thread de log executando...\n");
     int log_counter = 0;
     while (1) {
         usleep(300000);
-        printf("Log: Thread de log realizou registro %d ...\n", ++log_counter);
+        // Só enfileira o registro; quem formata e grava é o consumidor do log
+        LOG_ASSINCRONO("Log: Thread de log realizou registro %lld ...\n", ++log_counter);
+    }
+    LOG_ASSINCRONO("Thread de log finalizada.\n");
+    return NULL;
+}
+
+// ---------------------------------------------------------------------
+// Modo jitter (no estilo do cyclictest): uma thread periódica dorme até
+// instantes absolutos com clock_nanosleep e mede quanto acordou atrasada,
+// enquanto threads de carga giram em laço ocupado como tarefa_processamento.
+// ---------------------------------------------------------------------
+
+typedef struct {
+    long periodo_ns;
+    int amostras;
+    long long *atrasos; // ns entre o despertar previsto e o real
+} Medicao;
+
+typedef struct {
+    long long p50, p99, maximo;
+    double media;
+} Jitter;
+
+atomic_int parar_carga;
+
+void *tarefa_carga(void *arg) {
+    volatile unsigned long giros = 0;
+    while (!atomic_load_explicit(&parar_carga, memory_order_relaxed)) giros++;
+    return arg;
+}
+
+void *tarefa_periodica(void *arg) {
+    Medicao *m = arg;
+    struct timespec previsto, agora;
+    clock_gettime(CLOCK_MONOTONIC, &previsto);
+    for (int i=0; i<m->amostras; i++) {
+        previsto.tv_nsec += m->periodo_ns;
+        while (previsto.tv_nsec >= 1000000000L) {
+            previsto.tv_nsec -= 1000000000L;
+            previsto.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &previsto, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &agora);
+        m->atrasos[i] = (agora.tv_sec - previsto.tv_sec) * 1000000000LL
+                        + (agora.tv_nsec - previsto.tv_nsec);
     }
-    printf("Thread de log finalizada.\n");
     return NULL;
 }
 
-int main() {
+int comparar_atrasos(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Mede o jitter da thread periódica com num_carga threads de carga.
+// Devolve 0, ou o erro ao criar as threads (EPERM sem privilégio para FIFO).
+int medir_jitter(Escalonamento medidor, Escalonamento carga, int num_carga,
+                 long periodo_us, int amostras, Jitter *j) {
+    pthread_t t_medidor, *t_carga = malloc(num_carga * sizeof(pthread_t));
+    Medicao m = { periodo_us * 1000, amostras, malloc(amostras * sizeof(long long)) };
+    int criadas = 0, erro = 0;
+
+    atomic_store(&parar_carga, 0);
+    for (; criadas<num_carga && erro==0; criadas++) {
+        erro = criar_thread(&t_carga[criadas], PILHA_MENOR, NOT_DETACHED, carga, tarefa_carga, NULL);
+    }
+    if (erro != 0) criadas--;
+    if (erro == 0) {
+        usleep(100000); // deixa a carga ocupar as CPUs antes de medir
+        erro = criar_thread(&t_medidor, PILHA_MENOR, NOT_DETACHED, medidor, tarefa_periodica, &m);
+        if (erro == 0) pthread_join(t_medidor, NULL);
+    }
+    atomic_store(&parar_carga, 1);
+    for (int i=0; i<criadas; i++) pthread_join(t_carga[i], NULL);
+
+    if (erro == 0) {
+        qsort(m.atrasos, amostras, sizeof(long long), comparar_atrasos);
+        long long soma = 0;
+        for (int i=0; i<amostras; i++) soma += m.atrasos[i];
+        j->p50 = m.atrasos[amostras / 2];
+        j->p99 = m.atrasos[(int)(amostras * 0.99)];
+        j->maximo = m.atrasos[amostras - 1];
+        j->media = (double)soma / amostras;
+    }
+    free(m.atrasos);
+    free(t_carga);
+    return erro;
+}
+
+void imprimir_jitter(Escalonamento medidor, Escalonamento carga, int num_carga,
+                     long periodo_us, int amostras) {
+    char texto_medidor[32], texto_carga[48];
+    descrever(medidor, texto_medidor, sizeof(texto_medidor));
+    int n = snprintf(texto_carga, sizeof(texto_carga), "%d x ", num_carga);
+    descrever(carga, texto_carga + n, sizeof(texto_carga) - n);
+
+    Jitter j;
+    int erro = medir_jitter(medidor, carga, num_carga, periodo_us, amostras, &j);
+    if (erro == EPERM) {
+        printf("%-16s %-20s sem permissão (requer root ou CAP_SYS_NICE)\n",
+               texto_medidor, texto_carga);
+    } else if (erro != 0) {
+        printf("%-16s %-20s erro: %s\n", texto_medidor, texto_carga, strerror(erro));
+    } else {
+        printf("%-16s %-20s %10.1f %10.1f %10.1f %10.1f\n", texto_medidor, texto_carga,
+               j.p50 / 1e3, j.p99 / 1e3, j.maximo / 1e3, j.media / 1e3);
+    }
+}
+
+void imprimir_cabecalho_jitter(long periodo_us, int amostras) {
+    printf("Jitter de despertar: período %ld us, %d amostras\n\n", periodo_us, amostras);
+    printf("%-16s %-20s %10s %10s %10s %10s\n", "periódica", "carga",
+           "p50_us", "p99_us", "max_us", "media_us");
+}
+
+int ler_numero(const char *texto, int minimo, int *valor) {
+    char *fim;
+    long v = strtol(texto, &fim, 10);
+    if (*texto == '\0' || *fim != '\0' || v < minimo || v > 1000000000L) return 0;
+    *valor = (int)v;
+    return 1;
+}
+
+void uso(const char *programa) {
+    fprintf(stderr,
+            "Uso: %s                      (demonstração original)\n"
+            "     %s --jitter [--politica OTHER|BATCH|IDLE|FIFO] [--prioridade N]\n"
+            "                 [--cpu C] [--carga N] [--carga-politica P]\n"
+            "                 [--periodo US] [--amostras N]\n"
+            "     %s --comparar [--carga N] [--periodo US] [--amostras N]\n",
+            programa, programa, programa);
+}
+
+int main(int argc, char *argv[]) {
     pthread_t t_proc, t_log;
 
-    pthread_attr_t attr_proc = criar_atributos(PILHA_MAIOR, NOT_DETACHED);
-    pthread_create(&t_proc, &attr_proc, tarefa_processamento, NULL);
-    pthread_attr_destroy(&attr_proc);
+    if (argc > 1) {
+        int jitter = strcmp(argv[1], "--jitter") == 0;
+        int comparar = strcmp(argv[1], "--comparar") == 0;
+        Escalonamento medidor = ESCALONAMENTO_PADRAO, carga = ESCALONAMENTO_PADRAO;
+        int num_carga = (int)sysconf(_SC_NPROCESSORS_ONLN), periodo_us = 1000, amostras = 2000;
+        if (!jitter && !comparar) {
+            uso(argv[0]);
+            return 1;
+        }
+        for (int i=2; i<argc; i++) {
+            const char *opcao = argv[i], *valor = i + 1 < argc ? argv[++i] : "";
+            int ok;
+            if (strcmp(opcao, "--politica") == 0) ok = (medidor.politica = ler_politica(valor)) != -1;
+            else if (strcmp(opcao, "--carga-politica") == 0) ok = (carga.politica = ler_politica(valor)) != -1;
+            else if (strcmp(opcao, "--prioridade") == 0) ok = ler_numero(valor, 0, &medidor.prioridade);
+            else if (strcmp(opcao, "--cpu") == 0) ok = ler_numero(valor, 0, &medidor.cpu);
+            else if (strcmp(opcao, "--carga") == 0) ok = ler_numero(valor, 0, &num_carga);
+            else if (strcmp(opcao, "--periodo") == 0) ok = ler_numero(valor, 1, &periodo_us);
+            else if (strcmp(opcao, "--amostras") == 0) ok = ler_numero(valor, 1, &amostras);
+            else ok = 0;
+            if (!ok) {
+                fprintf(stderr, "Erro: opção inválida '%s %s'\n", opcao, valor);
+                uso(argv[0]);
+                return 1;
+            }
+        }
+        int minima = sched_get_priority_min(medidor.politica);
+        int maxima = sched_get_priority_max(medidor.politica);
+        if (medidor.prioridade == 0 && medidor.politica == SCHED_FIFO) medidor.prioridade = maxima - 19;
+        if (medidor.prioridade < minima || medidor.prioridade > maxima) {
+            fprintf(stderr, "Erro: prioridade de %s deve estar entre %d e %d\n",
+                    nome_politica(medidor.politica), minima, maxima);
+            return 1;
+        }
+        // Carga em FIFO precisa de prioridade válida: fica na mínima
+        if (carga.politica == SCHED_FIFO) carga.prioridade = sched_get_priority_min(SCHED_FIFO);
+        if (medidor.cpu >= (int)sysconf(_SC_NPROCESSORS_ONLN)) {
+            fprintf(stderr, "Erro: CPU %d não existe\n", medidor.cpu);
+            return 1;
+        }
 
-    pthread_attr_t attr_log = criar_atributos(PILHA_MENOR, DETACHED);
-    pthread_create(&t_log, &attr_log, tarefa_log, NULL);
-    pthread_attr_destroy(&attr_log);
+        imprimir_cabecalho_jitter(periodo_us, amostras);
+        if (jitter) {
+            carga.cpu = medidor.cpu; // carga e medidor disputam o mesmo núcleo
+            imprimir_jitter(medidor, carga, num_carga, periodo_us, amostras);
+            return 0;
+        }
+        // Todas no núcleo 0, para que a carga dispute a CPU com a thread periódica
+        Escalonamento other = {SCHED_OTHER, 0, 0}, batch = {SCHED_BATCH, 0, 0};
+        Escalonamento idle = {SCHED_IDLE, 0, 0}, fifo = {SCHED_FIFO, 80, 0};
+        imprimir_jitter(other, other, 0, periodo_us, amostras);
+        imprimir_jitter(other, other, num_carga, periodo_us, amostras);
+        imprimir_jitter(other, batch, num_carga, periodo_us, amostras);
+        imprimir_jitter(other, idle, num_carga, periodo_us, amostras);
+        imprimir_jitter(fifo, other, num_carga, periodo_us, amostras);
+        return 0;
+    }
+
+    log_iniciar(STDOUT_FILENO);
+
+    // O laço pesado vai para SCHED_BATCH: o escalonador o trata como não
+    // interativo, e a thread de log (SCHED_OTHER) acorda no horário
+    Escalonamento esc_proc = {SCHED_BATCH, 0, QUALQUER_CPU};
+    int erro = criar_thread(&t_proc, PILHA_MAIOR, NOT_DETACHED, esc_proc, tarefa_processamento, NULL);
+    if (erro != 0) {
+        fprintf(stderr, "Erro ao criar a thread de processamento: %s\n", strerror(erro));
+        return 1;
+    }
+
+    erro = criar_thread(&t_log, PILHA_MENOR, DETACHED, ESCALONAMENTO_PADRAO, tarefa_log, NULL);
+    if (erro != 0) {
+        fprintf(stderr, "Erro ao criar a thread de log: %s\n", strerror(erro));
+        return 1;
+    }
 
     pthread_join(t_proc, NULL); 
     sleep(1);
+    log_encerrar();
     printf("Programa principal finalizado.\n");
 
     return 0;